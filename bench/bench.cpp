@@ -46,6 +46,262 @@ void BM_Stackless(benchmark::State& state)
 
 BENCHMARK(BM_Stackless)->Unit(benchmark::TimeUnit::kNanosecond);
 
+#include "coro/timer.h"
+#include <random>
+#include <vector>
+
+// insert range(0) timers spread over 10s, cancel every other one, then expire all of them in 1ms steps
+template<typename Timer>
+void BM_Timer(benchmark::State& state)
+{
+    auto n = static_cast<size_t>(state.range(0));
+    std::mt19937_64 rng{ 42 };
+    std::vector<std::chrono::microseconds> deadlines(n);
+    for (auto& d : deadlines) d = std::chrono::microseconds(static_cast<int64_t>(rng() % 10000000));
+
+    std::vector<coro::timer_id> ids(n);
+    for (auto _ : state)
+    {
+        Timer timers;
+        for (size_t i = 0; i < n; i++) ids[i] = timers.add(deadlines[i], i);
+        for (size_t i = 0; i < n; i += 2) timers.cancel(ids[i]);
+        for (auto t = std::chrono::microseconds(0); !timers.empty(); t += std::chrono::milliseconds(1))
+            timers.expire(t, [](size_t v) { benchmark::DoNotOptimize(v); });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+BENCHMARK_TEMPLATE(BM_Timer, coro::timer_heap<size_t>)->Range(1 << 10, 1 << 18)->Unit(benchmark::TimeUnit::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Timer, coro::timing_wheel<size_t>)->Range(1 << 10, 1 << 18)->Unit(benchmark::TimeUnit::kMillisecond);
+
+#include "coro/task.h"
+#include <memory_resource>
+#include <cstdlib>
+
+// count every global allocation, to show what the frame pool saves
+static size_t global_allocations = 0;
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"  // false positive on replaced global operator new / delete
+#endif
+
+void* operator new(std::size_t n)
+{
+    global_allocations++;
+    if (auto* p = std::malloc(n)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// frames from plain global new, as without the class-level operator new of the promises
+struct global_new_resource : std::pmr::memory_resource
+{
+    void* do_allocate(std::size_t bytes, std::size_t) override { return ::operator new(bytes); }
+    void do_deallocate(void* p, std::size_t, std::size_t) override { ::operator delete(p); }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+} global_new;
+
+coro::task<int> await_chain(int depth)
+{
+    if (depth == 0) co_return 0;
+    co_return 1 + co_await await_chain(depth - 1);
+}
+
+// run an await chain of range(0) nested tasks per iteration, with frames from global new / the thread-local pool
+void BM_AwaitChain(benchmark::State& state, std::pmr::memory_resource* resource)
+{
+    auto depth = static_cast<int>(state.range(0));
+    coro::set_frame_resource(resource);
+    auto before = global_allocations;
+    for (auto _ : state)
+    {
+        auto t = await_chain(depth);
+        t.resume();
+        benchmark::DoNotOptimize(t.promise().result());
+    }
+    state.counters["allocs/chain"] = static_cast<double>(global_allocations - before) / static_cast<double>(state.iterations());
+    coro::set_frame_resource(nullptr);
+}
+
+BENCHMARK_CAPTURE(BM_AwaitChain, global_new, &global_new)->Arg(16)->Unit(benchmark::TimeUnit::kNanosecond);
+BENCHMARK_CAPTURE(BM_AwaitChain, frame_pool, nullptr)->Arg(16)->Unit(benchmark::TimeUnit::kNanosecond);
+
+struct ready_awaiter
+{
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept { }
+    int await_resume() const noexcept { return 1; }
+};
+
+coro::task<int> await_loop(int n)
+{
+    int sum = 0;
+    for (int i = 0; i < n; i++) sum += co_await ready_awaiter{ };
+    co_return sum;
+}
+
+// range(0) awaits that never suspend, i.e. the bare await_transform overhead, compare bench (traced in debug builds)
+// with bench_untraced (CORO_TRACING=0)
+void BM_AwaitOverhead(benchmark::State& state)
+{
+    auto n = static_cast<int>(state.range(0));
+    for (auto _ : state)
+    {
+        auto t = await_loop(n);
+        t.resume();
+        benchmark::DoNotOptimize(t.promise().result());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+    state.SetLabel(CORO_TRACING ? "traced" : "untraced");
+}
+
+BENCHMARK(BM_AwaitOverhead)->Arg(1024)->Unit(benchmark::TimeUnit::kNanosecond);
+
+#include "coro/loop.h"
+#include <queue>
+
+coro::task<> suspend_forever()
+{
+    while (true) co_await std::suspend_always{ };
+}
+
+// range(0) suspended tasks pushed and resumed once per iteration, as Loop::run_once did before: a std::queue of
+// handle_wrapper and a virtual run()
+void BM_DispatchVirtual(benchmark::State& state)
+{
+    std::vector<coro::task<>> tasks;
+    for (int64_t i = 0; i < state.range(0); i++) tasks.push_back(suspend_forever());
+    std::queue<coro::handle_wrapper> queue;
+    for (auto _ : state)
+    {
+        for (auto& t : tasks) queue.push({ t.promise().get_handle_id(), &t.promise() });
+        while (!queue.empty())
+        {
+            auto [id, h] = queue.front();
+            queue.pop();
+            h->run();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the same through Loop's handle_queue ring, resuming the bound coroutine directly
+void BM_DispatchRing(benchmark::State& state)
+{
+    std::vector<coro::task<>> tasks;
+    for (int64_t i = 0; i < state.range(0); i++) tasks.push_back(suspend_forever());
+    coro::handle_queue queue;
+    for (auto _ : state)
+    {
+        for (auto& t : tasks) queue.push(&t.promise());
+        while (!queue.empty()) queue.pop()->dispatch();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_DispatchVirtual)->Arg(64)->Arg(1024)->Arg(16384)->Unit(benchmark::TimeUnit::kMicrosecond);
+BENCHMARK(BM_DispatchRing)->Arg(64)->Arg(1024)->Arg(16384)->Unit(benchmark::TimeUnit::kMicrosecond);
+
+struct reschedule
+{
+    coro::Loop& loop;
+
+    bool await_ready() const noexcept { return false; }
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> coroutine) { loop.call(coroutine.promise()); }
+    void await_resume() const noexcept { }
+};
+
+coro::task<> yielder(coro::Loop& loop, int n)
+{
+    for (int i = 0; i < n; i++) co_await reschedule{ loop };
+}
+
+// 64 tasks yielding back to the loop range(0) times each, whole run_once iterations
+void BM_LoopDispatch(benchmark::State& state)
+{
+    auto n = static_cast<int>(state.range(0));
+    coro::Loop loop;
+    for (auto _ : state)
+    {
+        std::vector<coro::task<>> tasks;
+        for (int i = 0; i < 64; i++) tasks.push_back(yielder(loop, n));
+        for (auto& t : tasks) loop.call(t);
+        loop.run_until_complete();
+    }
+    state.SetItemsProcessed(state.iterations() * 64 * n);
+}
+
+BENCHMARK(BM_LoopDispatch)->Arg(256)->Unit(benchmark::TimeUnit::kMicrosecond);
+
+coro::task<> leaf() { co_return; }
+
+// range(0) short tasks kept alive by the caller until the loop is done
+void BM_LoopCallKept(benchmark::State& state)
+{
+    coro::Loop loop;
+    for (auto _ : state)
+    {
+        std::vector<coro::task<>> tasks;
+        tasks.reserve(static_cast<size_t>(state.range(0)));
+        for (int64_t i = 0; i < state.range(0); i++) tasks.push_back(leaf());
+        for (auto& t : tasks) loop.call(t);
+        loop.run_until_complete();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// the same tasks owned by the loop, frames are freed at final_suspend
+void BM_LoopSpawnRange(benchmark::State& state)
+{
+    coro::Loop loop;
+    for (auto _ : state)
+    {
+        std::vector<coro::task<>> tasks;
+        tasks.reserve(static_cast<size_t>(state.range(0)));
+        for (int64_t i = 0; i < state.range(0); i++) tasks.push_back(leaf());
+        loop.spawn_range(tasks);
+        loop.run_until_complete();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_LoopCallKept)->Arg(100000)->Unit(benchmark::TimeUnit::kMicrosecond);
+BENCHMARK(BM_LoopSpawnRange)->Arg(100000)->Unit(benchmark::TimeUnit::kMicrosecond);
+
+#include "coro/sharded.h"
+#include <atomic>
+
+coro::task<size_t> echo(size_t value) { co_return value; }
+
+// 4096 round trips to the next shard, one at a time
+coro::task<> loopback(coro::sharded_runtime& rt, std::atomic<size_t>& finished)
+{
+    auto next = (rt.current_shard() + 1) % rt.size();
+    for (size_t i = 0; i < 4096; i++) benchmark::DoNotOptimize(co_await rt.submit_to(next, echo(i)));
+    if (finished.fetch_add(1, std::memory_order_release) + 1 == rt.size()) finished.notify_one();
+}
+
+// every shard pings its neighbour through the SPSC rings, round trips per second should grow with range(0)
+// as long as every shard has a cpu of its own
+void BM_ShardedLoopback(benchmark::State& state)
+{
+    auto shards = static_cast<size_t>(state.range(0));
+    coro::sharded_runtime rt{ shards };
+    for (auto _ : state)
+    {
+        std::atomic<size_t> finished{ 0 };
+        for (size_t i = 0; i < shards; i++) rt.spawn_on(i, loopback(rt, finished));
+        for (auto n = finished.load(std::memory_order_acquire); n != shards; n = finished.load(std::memory_order_acquire))
+            finished.wait(n, std::memory_order_acquire);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(shards) * 4096);
+}
+
+BENCHMARK(BM_ShardedLoopback)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::TimeUnit::kMillisecond);
+
 BENCHMARK_MAIN();
 
 /*
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace coro
+{
+    /**
+     * Bounded multi-producer multi-consumer channel between coroutines, `co_await ch.send(v)` suspends while the channel is full,
+     * `co_await ch.recv()` while it is empty.
+     *
+     * Items live in a ring of sequence-numbered cells (Vyukov's bounded MPMC queue), producers and consumers claim cells with
+     * one CAS on their own cache line, the batch variants claim a whole run of cells with a single CAS. Suspended senders and
+     * receivers are linked intrusively in FIFO lists guarded by a mutex, which the fast paths only touch when someone waits:
+     * a failed attempt registers as waiter before retrying and every transfer checks the waiter count afterwards,
+     * with a fence on both sides so one of them always sees the other.
+     *
+     * After `close` sending fails, receiving drains the remaining items and then yields `std::nullopt`. Waiters are resumed
+     * inline by whoever frees their slot or item, like `event::set` does.
+     */
+    template<typename T>
+    class async_channel
+    {
+        struct cell
+        {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            T* value() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+        };
+
+        template<typename Awaiter>
+        struct waiter_list
+        {
+            Awaiter* head{ nullptr };
+            Awaiter* tail{ nullptr };
+
+            bool empty() const noexcept { return head == nullptr; }
+
+            void push(Awaiter& w) noexcept
+            {
+                w.m_next = nullptr;
+                if (tail != nullptr) tail->m_next = &w;
+                else head = &w;
+                tail = &w;
+            }
+
+            Awaiter* pop() noexcept
+            {
+                auto* w = std::exchange(head, head->m_next);
+                if (head == nullptr) tail = nullptr;
+                return w;
+            }
+        };
+
+    public:
+        // the capacity is rounded up to a power of two, at least 2
+        explicit async_channel(size_t capacity)
+            : m_capacity(std::bit_ceil(std::max<size_t>(capacity, 2))), m_mask(m_capacity - 1), m_cells(new cell[m_capacity])
+        {
+            for (size_t i = 0; i < m_capacity; i++) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        async_channel(async_channel const&) = delete;
+        async_channel(async_channel&&) = delete;
+        async_channel& operator=(async_channel const&) = delete;
+        async_channel& operator=(async_channel&&) = delete;
+
+        ~async_channel()
+        {
+            auto end = m_enqueue.load(std::memory_order_relaxed);
+            for (auto pos = m_dequeue.load(std::memory_order_relaxed); pos != end; pos++) std::destroy_at(cell_at(pos).value());
+        }
+
+        class send_awaiter
+        {
+        public:
+            send_awaiter(async_channel& channel, T&& value) : m_channel(channel), m_value(std::move(value)) { }
+
+            bool await_ready()
+            {
+                m_sent = m_channel.try_send(std::move(m_value));
+                return m_sent || m_channel.is_closed();
+            }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                m_coroutine = coroutine;
+                return m_channel.enqueue(*this);
+            }
+
+            // false if the channel was closed and the value dropped
+            bool await_resume() const noexcept { return m_sent; }
+
+        private:
+            friend async_channel;
+
+            async_channel& m_channel;
+            T m_value;
+            bool m_sent{ false };
+            std::coroutine_handle<> m_coroutine{ nullptr };
+            send_awaiter* m_next{ nullptr };
+        };
+
+        class recv_awaiter
+        {
+        public:
+            explicit recv_awaiter(async_channel& channel) noexcept : m_channel(channel) { }
+
+            bool await_ready()
+            {
+                m_value = m_channel.try_recv();
+                return m_value.has_value() || m_channel.is_closed();
+            }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                m_coroutine = coroutine;
+                return m_channel.enqueue(*this);
+            }
+
+            // std::nullopt once the channel is closed and drained
+            std::optional<T> await_resume() { return std::move(m_value); }
+
+        private:
+            friend async_channel;
+
+            async_channel& m_channel;
+            std::optional<T> m_value;
+            std::coroutine_handle<> m_coroutine{ nullptr };
+            recv_awaiter* m_next{ nullptr };
+        };
+
+        // `bool sent = co_await ch.send(v)`, false if the channel is closed
+        send_awaiter send(T value) { return send_awaiter{ *this, std::move(value) }; }
+
+        // `std::optional<T> v = co_await ch.recv()`
+        recv_awaiter recv() noexcept { return recv_awaiter{ *this }; }
+
+        // never suspends, `value` is only moved from on success
+        template<typename U>
+        bool try_send(U&& value)
+        {
+            if (is_closed() || !push(std::forward<U>(value))) return false;
+            on_pushed();
+            return true;
+        }
+
+        std::optional<T> try_recv()
+        {
+            std::optional<T> value;
+            if (pop(value)) on_popped();
+            return value;
+        }
+
+        // moves up to `n` items from `first` with one CAS, returns how many were sent
+        template<std::input_iterator It>
+        size_t try_send_n(It first, size_t n)
+        {
+            if (is_closed()) return 0;
+            size_t pos = 0;
+            auto count = claim(m_enqueue, 0, n, pos);
+            for (size_t i = 0; i < count; i++, ++first)
+            {
+                auto& c = cell_at(pos + i);
+                std::construct_at(c.value(), std::move(*first));
+                c.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            if (count > 0) on_pushed();
+            return count;
+        }
+
+        // receives up to `n` items into `out` with one CAS, returns how many were received
+        template<std::output_iterator<T> It>
+        size_t try_recv_n(It out, size_t n)
+        {
+            size_t pos = 0;
+            auto count = claim(m_dequeue, 1, n, pos);
+            for (size_t i = 0; i < count; i++, ++out)
+            {
+                auto& c = cell_at(pos + i);
+                *out = std::move(*c.value());
+                std::destroy_at(c.value());
+                c.sequence.store(pos + i + m_capacity, std::memory_order_release);
+            }
+            if (count > 0) on_popped();
+            return count;
+        }
+
+        // fails pending and future sends, wakes every waiter, items already sent can still be received
+        void close()
+        {
+            waiter_list<send_awaiter> senders;
+            waiter_list<recv_awaiter> receivers;
+            {
+                std::lock_guard lock(m_mutex);
+                m_closed.store(true, std::memory_order_release);
+                senders = std::exchange(m_senders, {});
+                receivers = std::exchange(m_receivers, {});
+                m_waiting_senders.store(0, std::memory_order_relaxed);
+                m_waiting_receivers.store(0, std::memory_order_relaxed);
+            }
+            while (!senders.empty()) senders.pop()->m_coroutine.resume();
+            while (!receivers.empty())
+            {
+                auto* w = receivers.pop();
+                pop(w->m_value);  // a send racing with `close` may have landed meanwhile
+                w->m_coroutine.resume();
+            }
+        }
+
+        bool is_closed() const noexcept { return m_closed.load(std::memory_order_acquire); }
+        size_t capacity() const noexcept { return m_capacity; }
+
+        // approximate while other threads are sending or receiving
+        size_t size() const noexcept { return m_enqueue.load(std::memory_order_relaxed) - m_dequeue.load(std::memory_order_relaxed); }
+
+    private:
+        cell& cell_at(size_t pos) const noexcept { return m_cells[pos & m_mask]; }
+
+        /**
+         * Claims up to `n` consecutive cells at `position` with one CAS, returns the count and the first position in `first`.
+         * A cell is ready for producers when its sequence equals its position and for consumers one past it (`offset`).
+         */
+        size_t claim(std::atomic<size_t>& position, size_t offset, size_t n, size_t& first) noexcept
+        {
+            auto pos = position.load(std::memory_order_relaxed);
+            while (n > 0)
+            {
+                size_t count = 0;
+                while (count < n && cell_at(pos + count).sequence.load(std::memory_order_acquire) == pos + count + offset) count++;
+                if (count == 0)
+                {
+                    auto lag = static_cast<std::ptrdiff_t>(cell_at(pos).sequence.load(std::memory_order_acquire) - (pos + offset));
+                    if (lag < 0) return 0;  // full or empty
+                    pos = position.load(std::memory_order_relaxed);  // another thread claimed it
+                    continue;
+                }
+                if (position.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed, std::memory_order_relaxed))
+                {
+                    first = pos;
+                    return count;
+                }
+            }
+            return 0;
+        }
+
+        template<typename U>
+        bool push(U&& value)
+        {
+            size_t pos = 0;
+            if (claim(m_enqueue, 0, 1, pos) == 0) return false;
+            auto& c = cell_at(pos);
+            std::construct_at(c.value(), std::forward<U>(value));
+            c.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(std::optional<T>& value)
+        {
+            size_t pos = 0;
+            if (claim(m_dequeue, 1, 1, pos) == 0) return false;
+            auto& c = cell_at(pos);
+            value.emplace(std::move(*c.value()));
+            std::destroy_at(c.value());
+            c.sequence.store(pos + m_capacity, std::memory_order_release);
+            return true;
+        }
+
+        // both return false if the transfer happened (or the channel closed) while registering, then there is nothing to wait for
+        bool enqueue(send_awaiter& w)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_closed.load(std::memory_order_relaxed)) return false;
+                m_waiting_senders.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!push(std::move(w.m_value)))
+                {
+                    m_senders.push(w);
+                    return true;
+                }
+                m_waiting_senders.fetch_sub(1, std::memory_order_relaxed);
+            }
+            w.m_sent = true;
+            on_pushed();
+            return false;
+        }
+
+        bool enqueue(recv_awaiter& w)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_closed.load(std::memory_order_relaxed))
+                {
+                    pop(w.m_value);
+                    return false;
+                }
+                m_waiting_receivers.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!pop(w.m_value))
+                {
+                    m_receivers.push(w);
+                    return true;
+                }
+                m_waiting_receivers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            on_popped();
+            return false;
+        }
+
+        // after items were pushed, hand them to waiting receivers
+        void on_pushed()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiting_receivers.load(std::memory_order_relaxed) == 0) return;
+
+            waiter_list<recv_awaiter> resumed;
+            {
+                std::lock_guard lock(m_mutex);
+                while (!m_receivers.empty() && pop(m_receivers.head->m_value))
+                {
+                    resumed.push(*m_receivers.pop());
+                    m_waiting_receivers.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            if (resumed.empty()) return;
+            on_popped();
+            while (!resumed.empty()) resumed.pop()->m_coroutine.resume();
+        }
+
+        // after items were popped, move the values of waiting senders into the freed cells
+        void on_popped()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_waiting_senders.load(std::memory_order_relaxed) == 0) return;
+
+            waiter_list<send_awaiter> resumed;
+            {
+                std::lock_guard lock(m_mutex);
+                while (!m_senders.empty() && push(std::move(m_senders.head->m_value)))
+                {
+                    auto* w = m_senders.pop();
+                    w->m_sent = true;
+                    resumed.push(*w);
+                    m_waiting_senders.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            if (resumed.empty()) return;
+            on_pushed();
+            while (!resumed.empty()) resumed.pop()->m_coroutine.resume();
+        }
+
+    private:
+        size_t const m_capacity;
+        size_t const m_mask;
+        std::unique_ptr<cell[]> m_cells;
+
+        alignas(64) std::atomic<size_t> m_enqueue{ 0 };
+        alignas(64) std::atomic<size_t> m_dequeue{ 0 };
+
+        alignas(64) std::atomic<size_t> m_waiting_senders{ 0 };
+        std::atomic<size_t> m_waiting_receivers{ 0 };
+        std::atomic<bool> m_closed{ false };
+
+        std::mutex m_mutex;  // guards the waiter lists
+        waiter_list<send_awaiter> m_senders;
+        waiter_list<recv_awaiter> m_receivers;
+    };
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <coroutine>
+#include <type_traits>
+#include <exception>
+#include <utility>
+#include <memory>
+
+#include "task.h"
+
+namespace coro
+{
+    /**
+     * Lazy generator whose body may `co_await` between yields (I/O, timers, tasks, events).
+     *
+     *     for (auto it = co_await gen.begin(); it != gen.end(); co_await ++it) use(*it);
+     *     while (auto* v = co_await gen.next()) use(*v);
+     *
+     * The consumer resumes the generator by symmetric transfer and each `co_yield` transfers straight back, the consumer
+     * gets a reference to the yielded object in the generator's frame, nothing is copied. The promise is a task promise,
+     * the consumer is its continuation, so frames are pooled and async backtraces run through the generator.
+     * Only one `next` may be outstanding, and the generator must not be destroyed while suspended in a `co_await`.
+     */
+    template<typename T>
+    class async_generator
+    {
+    public:
+        using value_type = std::remove_reference_t<T>;
+        using pointer_type = value_type*;
+        using reference_type = std::conditional_t<std::is_reference_v<T>, T, T&>;
+
+        struct promise_type;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        struct promise_type final : detail::promise_base
+        {
+            async_generator get_return_object() noexcept
+            {
+                auto h = handle_type::from_promise(*this);
+                bind_coroutine(h);
+                return async_generator{ h };
+            }
+
+            // hands the value to the consumer, transferring to it like a completing task does
+            final_awaiter yield_value(value_type& value) noexcept
+            {
+                m_value = std::addressof(value);
+                return { };
+            }
+
+            final_awaiter yield_value(value_type&& value) noexcept
+            {
+                m_value = std::addressof(value);
+                return { };
+            }
+
+            final_awaiter final_suspend() noexcept
+            {
+                m_value = nullptr;
+                return { };
+            }
+
+            void return_void() noexcept { }
+
+            void run() override final { auto h = handle_type::from_promise(*this); if (!h.done()) h.resume(); }
+
+            // nullptr once finished, rethrows what escaped the body
+            pointer_type value() const
+            {
+                if (m_exception_ptr)
+                    std::rethrow_exception(m_exception_ptr);
+                return m_value;
+            }
+
+        private:
+            pointer_type m_value{ nullptr };
+        };
+
+        struct sentinel { };
+
+        class iterator;
+
+        // resumes the generator until its next yield or its end
+        class advance_awaiter
+        {
+        public:
+            explicit advance_awaiter(handle_type coroutine) noexcept : m_coroutine(coroutine) { }
+
+            bool await_ready() const noexcept { return m_coroutine == nullptr || m_coroutine.done(); }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> consumer) noexcept
+            {
+                m_coroutine.promise().set_continuation(consumer);
+#if CORO_TRACING
+                detail::set_current_promise(&m_coroutine.promise());
+#endif
+                return m_coroutine;
+            }
+
+            // the yielded value, nullptr at the end
+            pointer_type await_resume() const { return m_coroutine != nullptr ? m_coroutine.promise().value() : nullptr; }
+
+        protected:
+            handle_type m_coroutine;
+        };
+
+        class iterator
+        {
+        public:
+            iterator() = default;
+            explicit iterator(handle_type coroutine) noexcept : m_coroutine(coroutine) { }
+
+            friend bool operator==(iterator const& it, sentinel) noexcept { return it.m_coroutine == nullptr || it.m_coroutine.done(); }
+
+            // `co_await ++it`
+            auto operator++() noexcept
+            {
+                struct awaiter : advance_awaiter
+                {
+                    iterator& m_it;
+                    awaiter(iterator& it) noexcept : advance_awaiter(it.m_coroutine), m_it(it) { }
+                    iterator& await_resume() const { advance_awaiter::await_resume(); return m_it; }
+                };
+                return awaiter{ *this };
+            }
+
+            reference_type operator*() const noexcept { return static_cast<reference_type>(*m_coroutine.promise().value()); }
+            pointer_type operator->() const noexcept { return m_coroutine.promise().value(); }
+
+        private:
+            handle_type m_coroutine{ nullptr };
+        };
+
+        async_generator() = default;
+        explicit async_generator(handle_type handle) noexcept : m_coroutine(handle) { }
+        async_generator(async_generator const&) = delete;
+        async_generator(async_generator&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, nullptr)) { }
+
+        async_generator& operator=(async_generator const&) = delete;
+        async_generator& operator=(async_generator&& other) noexcept
+        {
+            if (std::addressof(other) != this)
+            {
+                if (m_coroutine != nullptr)
+                    m_coroutine.destroy();
+                m_coroutine = std::exchange(other.m_coroutine, nullptr);
+            }
+            return *this;
+        }
+
+        ~async_generator()
+        {
+            if (m_coroutine != nullptr)
+                m_coroutine.destroy();
+        }
+
+        // `pointer_type p = co_await gen.next()`, nullptr once the generator finished
+        advance_awaiter next() noexcept { return advance_awaiter{ m_coroutine }; }
+
+        // `iterator it = co_await gen.begin()`, runs the generator to its first yield
+        auto begin() noexcept
+        {
+            struct awaiter : advance_awaiter
+            {
+                using advance_awaiter::advance_awaiter;
+                iterator await_resume() const { advance_awaiter::await_resume(); return iterator{ this->m_coroutine }; }
+            };
+            return awaiter{ m_coroutine };
+        }
+
+        sentinel end() noexcept { return { }; }
+
+        bool is_done() const noexcept { return m_coroutine == nullptr || m_coroutine.done(); }
+
+    private:
+        handle_type m_coroutine{ nullptr };
+    };
+}
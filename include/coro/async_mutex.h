@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <utility>
+
+namespace coro
+{
+    class async_mutex;
+
+    // owns a locked async_mutex, unlocks on destruction
+    class async_mutex_lock
+    {
+    public:
+        explicit async_mutex_lock(async_mutex& mutex) noexcept : m_mutex(&mutex) { }
+        async_mutex_lock(async_mutex_lock&& other) noexcept : m_mutex(std::exchange(other.m_mutex, nullptr)) { }
+        async_mutex_lock(async_mutex_lock const&) = delete;
+        async_mutex_lock& operator=(async_mutex_lock const&) = delete;
+        async_mutex_lock& operator=(async_mutex_lock&&) = delete;
+        ~async_mutex_lock();
+
+    private:
+        async_mutex* m_mutex;
+    };
+
+    /**
+     * Mutex whose `lock_async` suspends the awaiting coroutine instead of blocking the thread.
+     *
+     * Like `event`, waiters are pushed onto a lock-free intrusive stack living in the state word,
+     * the current holder detaches that stack on `unlock`, reverses it into a FIFO list and hands the lock directly to its head,
+     * which is resumed inside `unlock`. Locking an unlocked mutex is a single CAS, no allocation happens at all.
+     */
+    class async_mutex
+    {
+        static constexpr uintptr_t not_locked = 1;
+        static constexpr uintptr_t locked_no_waiters = 0;
+        // otherwise: locked, the state is the most recent waiter
+
+    public:
+        async_mutex() = default;
+        async_mutex(async_mutex const&) = delete;
+        async_mutex(async_mutex&&) = delete;
+        async_mutex& operator=(async_mutex const&) = delete;
+        async_mutex& operator=(async_mutex&&) = delete;
+
+        class lock_awaiter
+        {
+        public:
+            explicit lock_awaiter(async_mutex& mutex) noexcept : m_mutex(mutex) { }
+
+            bool await_ready() noexcept { return m_mutex.try_lock(); }
+
+            bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+            {
+                m_coroutine = coroutine;
+                auto old = m_mutex.m_state.load(std::memory_order_acquire);
+                while (true)
+                {
+                    if (old == not_locked)
+                    {
+                        if (m_mutex.m_state.compare_exchange_weak(old, locked_no_waiters, std::memory_order_acquire, std::memory_order_acquire))
+                            return false;  // unlocked meanwhile, got it
+                    }
+                    else
+                    {
+                        m_next = reinterpret_cast<lock_awaiter*>(old);  // nullptr for locked_no_waiters
+                        if (m_mutex.m_state.compare_exchange_weak(old, reinterpret_cast<uintptr_t>(this), std::memory_order_release, std::memory_order_acquire))
+                            return true;
+                    }
+                }
+            }
+
+            void await_resume() const noexcept { }
+
+        protected:
+            friend async_mutex;
+
+            async_mutex& m_mutex;
+            std::coroutine_handle<> m_coroutine{ nullptr };
+            lock_awaiter* m_next{ nullptr };
+        };
+
+        class scoped_lock_awaiter : public lock_awaiter
+        {
+        public:
+            using lock_awaiter::lock_awaiter;
+
+            [[nodiscard]] async_mutex_lock await_resume() const noexcept { return async_mutex_lock{ m_mutex }; }
+        };
+
+        // single CAS, true if the mutex is now owned by the caller
+        bool try_lock() noexcept
+        {
+            auto expected = not_locked;
+            return m_state.compare_exchange_strong(expected, locked_no_waiters, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        // `co_await mutex.lock_async()`, call `unlock` afterwards
+        lock_awaiter lock_async() noexcept { return lock_awaiter{ *this }; }
+
+        // `auto lock = co_await mutex.scoped_lock_async()`, unlocked when `lock` goes out of scope
+        scoped_lock_awaiter scoped_lock_async() noexcept { return scoped_lock_awaiter{ *this }; }
+
+        // hands the mutex to the longest waiting coroutine and resumes it, or unlocks
+        void unlock() noexcept
+        {
+            auto* head = m_waiters;
+            if (head == nullptr)
+            {
+                auto old = locked_no_waiters;
+                if (m_state.compare_exchange_strong(old, not_locked, std::memory_order_release, std::memory_order_relaxed))
+                    return;
+
+                // detach the new waiters, reverse them into FIFO order
+                old = m_state.exchange(locked_no_waiters, std::memory_order_acquire);
+                auto* waiter = reinterpret_cast<lock_awaiter*>(old);
+                while (waiter != nullptr)
+                {
+                    auto* next = waiter->m_next;
+                    waiter->m_next = head;
+                    head = waiter;
+                    waiter = next;
+                }
+            }
+            m_waiters = head->m_next;
+            head->m_coroutine.resume();
+        }
+
+    private:
+        std::atomic<uintptr_t> m_state{ not_locked };
+        lock_awaiter* m_waiters{ nullptr };  // FIFO of detached waiters, only touched by the holder
+    };
+
+    inline async_mutex_lock::~async_mutex_lock()
+    {
+        if (m_mutex != nullptr) m_mutex->unlock();
+    }
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace coro
+{
+    class async_rwlock;
+
+    // owns a shared or exclusive lock of an async_rwlock, unlocks on destruction
+    class async_rwlock_lock
+    {
+    public:
+        async_rwlock_lock(async_rwlock& lock, bool shared) noexcept : m_lock(&lock), m_shared(shared) { }
+        async_rwlock_lock(async_rwlock_lock&& other) noexcept : m_lock(std::exchange(other.m_lock, nullptr)), m_shared(other.m_shared) { }
+        async_rwlock_lock(async_rwlock_lock const&) = delete;
+        async_rwlock_lock& operator=(async_rwlock_lock const&) = delete;
+        async_rwlock_lock& operator=(async_rwlock_lock&&) = delete;
+        ~async_rwlock_lock();
+
+    private:
+        async_rwlock* m_lock;
+        bool m_shared;
+    };
+
+    /**
+     * Writer-preferring reader / writer lock for coroutines, waiters suspend instead of blocking the thread.
+     *
+     * The state word holds the reader count, a writer bit and a waiting bit. Without waiters, taking or dropping
+     * a shared or exclusive lock is a single CAS (or RMW). Once anyone waits, every newcomer queues, so nobody overtakes:
+     * writers and readers wait in separate FIFO lists, an unlocking writer hands over to the next writer first
+     * and only admits all waiting readers at once when no writer waits. The lists are guarded by a mutex held only to
+     * link or unlink waiters.
+     */
+    class async_rwlock
+    {
+        static constexpr uint64_t writer = uint64_t{ 1 } << 63;
+        static constexpr uint64_t waiting = uint64_t{ 1 } << 62;  // set while any list is non-empty
+
+        struct waiter
+        {
+            std::coroutine_handle<> coroutine{ nullptr };
+            waiter* next{ nullptr };
+        };
+
+        struct waiter_list
+        {
+            waiter* head{ nullptr };
+            waiter* tail{ nullptr };
+
+            bool empty() const noexcept { return head == nullptr; }
+
+            void push(waiter& w) noexcept
+            {
+                w.next = nullptr;
+                if (tail != nullptr) tail->next = &w;
+                else head = &w;
+                tail = &w;
+            }
+
+            waiter* pop() noexcept
+            {
+                auto* w = std::exchange(head, head->next);
+                if (head == nullptr) tail = nullptr;
+                return w;
+            }
+        };
+
+    public:
+        async_rwlock() = default;
+        async_rwlock(async_rwlock const&) = delete;
+        async_rwlock(async_rwlock&&) = delete;
+        async_rwlock& operator=(async_rwlock const&) = delete;
+        async_rwlock& operator=(async_rwlock&&) = delete;
+
+        template<bool Shared, bool Scoped>
+        class lock_awaiter
+        {
+        public:
+            explicit lock_awaiter(async_rwlock& lock) noexcept : m_lock(lock) { }
+
+            bool await_ready() noexcept { return Shared ? m_lock.try_lock_shared() : m_lock.try_lock(); }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                m_waiter.coroutine = coroutine;
+                return Shared ? m_lock.enqueue_reader(m_waiter) : m_lock.enqueue_writer(m_waiter);
+            }
+
+            auto await_resume() const noexcept
+            {
+                if constexpr (Scoped) return async_rwlock_lock{ m_lock, Shared };
+            }
+
+        private:
+            async_rwlock& m_lock;
+            waiter m_waiter;
+        };
+
+        bool try_lock() noexcept
+        {
+            uint64_t expected = 0;
+            return m_state.compare_exchange_strong(expected, writer, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        bool try_lock_shared() noexcept
+        {
+            auto state = m_state.load(std::memory_order_relaxed);
+            while ((state & (writer | waiting)) == 0)
+                if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+            return false;
+        }
+
+        // exclusive, call `unlock` afterwards
+        lock_awaiter<false, false> lock_async() noexcept { return lock_awaiter<false, false>{ *this }; }
+        // shared, call `unlock_shared` afterwards
+        lock_awaiter<true, false> lock_shared_async() noexcept { return lock_awaiter<true, false>{ *this }; }
+
+        // `auto lock = co_await rwlock.scoped_lock_async()`
+        lock_awaiter<false, true> scoped_lock_async() noexcept { return lock_awaiter<false, true>{ *this }; }
+        lock_awaiter<true, true> scoped_lock_shared_async() noexcept { return lock_awaiter<true, true>{ *this }; }
+
+        void unlock()
+        {
+            uint64_t expected = writer;
+            if (m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed))
+                return;
+
+            waiter_list resumed;
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_writers.empty())
+                {
+                    resumed.push(*m_writers.pop());
+                    m_state.store(writer | flag(), std::memory_order_release);  // stays locked by the next writer
+                }
+                else
+                {
+                    uint64_t count = 0;
+                    for (; !m_readers.empty(); count++) resumed.push(*m_readers.pop());
+                    m_state.store(count, std::memory_order_release);
+                }
+            }
+            resume_all(resumed);
+        }
+
+        void unlock_shared()
+        {
+            if (m_state.fetch_sub(1, std::memory_order_acq_rel) != (waiting | 1)) return;
+
+            // the last reader with writers waiting, readers only wait behind writers
+            waiter* next = nullptr;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_state.load(std::memory_order_relaxed) != waiting || m_writers.empty()) return;  // a reader sorted it out
+                next = m_writers.pop();
+                m_state.store(writer | flag(), std::memory_order_relaxed);
+            }
+            next->coroutine.resume();
+        }
+
+    private:
+        uint64_t flag() const noexcept { return m_writers.empty() && m_readers.empty() ? 0 : waiting; }
+
+        // both return false if the lock was taken instead of waiting, called with the state in contention
+        bool enqueue_writer(waiter& w)
+        {
+            std::lock_guard lock(m_mutex);
+            m_writers.push(w);
+            // with only the waiting bit set, the last reader is on its way to hand over to the first writer
+            auto previous = m_state.fetch_or(waiting, std::memory_order_acquire);
+            if (previous != 0) return true;
+
+            // released before the waiting bit was set, then nobody else was waiting either
+            m_writers.pop();
+            m_state.store(writer | flag(), std::memory_order_relaxed);
+            return false;
+        }
+
+        bool enqueue_reader(waiter& w)
+        {
+            std::lock_guard lock(m_mutex);
+            auto state = m_state.load(std::memory_order_relaxed);
+            while ((state & writer) == 0 && m_writers.empty())  // unlocked meanwhile
+                if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return false;
+
+            m_readers.push(w);
+            auto previous = m_state.fetch_or(waiting, std::memory_order_acquire);
+            if ((previous & writer) != 0 || !m_writers.empty()) return true;
+
+            m_readers.pop();  // the writer left before the waiting bit was set
+            m_state.fetch_add(1, std::memory_order_relaxed);
+            if (m_readers.empty()) m_state.fetch_and(~waiting, std::memory_order_relaxed);
+            return false;
+        }
+
+        static void resume_all(waiter_list& list)
+        {
+            while (!list.empty()) list.pop()->coroutine.resume();
+        }
+
+    private:
+        std::atomic<uint64_t> m_state{ 0 };
+
+        std::mutex m_mutex;  // guards the lists
+        waiter_list m_writers;
+        waiter_list m_readers;
+    };
+
+    inline async_rwlock_lock::~async_rwlock_lock()
+    {
+        if (m_lock == nullptr) return;
+        if (m_shared) m_lock->unlock_shared();
+        else m_lock->unlock();
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace coro
+{
+    class async_semaphore;
+
+    // owns one permit of an async_semaphore, releases it on destruction
+    class async_semaphore_permit
+    {
+    public:
+        explicit async_semaphore_permit(async_semaphore& semaphore) noexcept : m_semaphore(&semaphore) { }
+        async_semaphore_permit(async_semaphore_permit&& other) noexcept : m_semaphore(std::exchange(other.m_semaphore, nullptr)) { }
+        async_semaphore_permit(async_semaphore_permit const&) = delete;
+        async_semaphore_permit& operator=(async_semaphore_permit const&) = delete;
+        async_semaphore_permit& operator=(async_semaphore_permit&&) = delete;
+        ~async_semaphore_permit();
+
+    private:
+        async_semaphore* m_semaphore;
+    };
+
+    /**
+     * Counting semaphore whose `acquire_async` suspends the awaiting coroutine instead of blocking the thread.
+     *
+     * The counter goes negative by the number of waiters, so acquiring with a permit available is a single atomic RMW
+     * and releasing without waiters another one. Waiters are linked intrusively in FIFO order and get the released permit
+     * handed over directly, newcomers cannot overtake them. The waiter list is shared by concurrent releasers,
+     * so it is guarded by a mutex held only to link or unlink a waiter, never while anyone is suspended.
+     */
+    class async_semaphore
+    {
+    public:
+        explicit async_semaphore(std::ptrdiff_t permits) noexcept : m_count(permits) { }
+        async_semaphore(async_semaphore const&) = delete;
+        async_semaphore(async_semaphore&&) = delete;
+        async_semaphore& operator=(async_semaphore const&) = delete;
+        async_semaphore& operator=(async_semaphore&&) = delete;
+
+        class acquire_awaiter
+        {
+        public:
+            explicit acquire_awaiter(async_semaphore& semaphore) noexcept : m_semaphore(semaphore) { }
+
+            // takes a permit or registers as a waiter in the counter
+            bool await_ready() noexcept { return m_semaphore.m_count.fetch_sub(1, std::memory_order_acquire) > 0; }
+
+            bool await_suspend(std::coroutine_handle<> coroutine)
+            {
+                m_coroutine = coroutine;
+                return m_semaphore.enqueue(*this);
+            }
+
+            void await_resume() const noexcept { }
+
+        protected:
+            friend async_semaphore;
+
+            async_semaphore& m_semaphore;
+            std::coroutine_handle<> m_coroutine{ nullptr };
+            acquire_awaiter* m_next{ nullptr };
+        };
+
+        class scoped_acquire_awaiter : public acquire_awaiter
+        {
+        public:
+            using acquire_awaiter::acquire_awaiter;
+
+            [[nodiscard]] async_semaphore_permit await_resume() const noexcept { return async_semaphore_permit{ m_semaphore }; }
+        };
+
+        bool try_acquire() noexcept
+        {
+            auto count = m_count.load(std::memory_order_relaxed);
+            while (count > 0)
+                if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    return true;
+            return false;
+        }
+
+        // `co_await semaphore.acquire_async()`, call `release` afterwards
+        acquire_awaiter acquire_async() noexcept { return acquire_awaiter{ *this }; }
+
+        // `auto permit = co_await semaphore.scoped_acquire_async()`, released when `permit` goes out of scope
+        scoped_acquire_awaiter scoped_acquire_async() noexcept { return scoped_acquire_awaiter{ *this }; }
+
+        // gives `n` permits back, each one resumes the longest waiting coroutine if there is one
+        void release(std::ptrdiff_t n = 1)
+        {
+            for (; n > 0; n--)
+                if (m_count.fetch_add(1, std::memory_order_release) < 0) wake_one();
+        }
+
+        // gives one permit back unless `max` are available already, false if it didn't, e.g. a binary semaphore with `max` 1
+        bool release_bounded(std::ptrdiff_t max)
+        {
+            auto count = m_count.load(std::memory_order_relaxed);
+            do
+            {
+                if (count >= max) return false;
+            }
+            while (!m_count.compare_exchange_weak(count, count + 1, std::memory_order_release, std::memory_order_relaxed));
+            if (count < 0) wake_one();
+            return true;
+        }
+
+        // permits available, negative by the number of waiters
+        std::ptrdiff_t available() const noexcept { return m_count.load(std::memory_order_relaxed); }
+
+    private:
+        // a released permit belongs to a waiter
+        void wake_one()
+        {
+            acquire_awaiter* waiter = nullptr;
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_head == nullptr)
+                    m_handoffs++;  // the waiter is between the counter and the list, let it pass
+                else
+                {
+                    waiter = std::exchange(m_head, m_head->m_next);
+                    if (m_head == nullptr) m_tail = nullptr;
+                }
+            }
+            if (waiter != nullptr) waiter->m_coroutine.resume();
+        }
+
+        // false if a permit was handed over meanwhile and the waiter must not suspend
+        bool enqueue(acquire_awaiter& waiter)
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_handoffs > 0)
+            {
+                m_handoffs--;
+                return false;
+            }
+            waiter.m_next = nullptr;
+            if (m_tail != nullptr) m_tail->m_next = &waiter;
+            else m_head = &waiter;
+            m_tail = &waiter;
+            return true;
+        }
+
+    private:
+        std::atomic<std::ptrdiff_t> m_count;
+
+        std::mutex m_mutex;  // guards the list and m_handoffs
+        acquire_awaiter* m_head{ nullptr };
+        acquire_awaiter* m_tail{ nullptr };
+        size_t m_handoffs{ 0 };
+    };
+
+    inline async_semaphore_permit::~async_semaphore_permit()
+    {
+        if (m_semaphore != nullptr) m_semaphore->release();
+    }
+}
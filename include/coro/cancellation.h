@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+namespace coro
+{
+    // what awaiting a cancelled operation throws, `std::errc::operation_canceled`
+    class operation_cancelled : public std::system_error
+    {
+    public:
+        operation_cancelled() : std::system_error(std::make_error_code(std::errc::operation_canceled)) { }
+    };
+
+    class cancellation_token;
+    class cancellation_source;
+
+    template<typename F>
+    class cancellation_callback;
+
+    namespace detail
+    {
+        // intrusive registration of a cancellation_callback, no allocation per callback
+        struct cancellation_node
+        {
+            void (*m_invoke)(cancellation_node&) noexcept { nullptr };
+            cancellation_node* m_prev{ nullptr };
+            cancellation_node* m_next{ nullptr };
+            bool m_linked{ false };
+        };
+
+        /**
+         * Shared by a source and its tokens, reference counted.
+         * Callbacks run on the cancelling thread with the mutex held, one at a time, so a callback may unregister
+         * other callbacks (or itself) and an unregistration on another thread waits for a running callback to return.
+         */
+        class cancellation_state
+        {
+        public:
+            void acquire() noexcept { m_refs.fetch_add(1, std::memory_order_relaxed); }
+
+            void release() noexcept
+            {
+                if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+            }
+
+            bool is_cancelled() const noexcept { return m_cancelled.load(std::memory_order_acquire); }
+
+            // false if this is not the first request
+            bool request() noexcept
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_cancelled.exchange(true, std::memory_order_acq_rel)) return false;
+                while (auto* node = m_head)
+                {
+                    unlink(*node);
+                    node->m_invoke(*node);  // may destroy the node
+                }
+                return true;
+            }
+
+            // false if already cancelled, the callback is then not registered
+            bool add(cancellation_node& node) noexcept
+            {
+                std::lock_guard lock(m_mutex);
+                if (is_cancelled()) return false;
+                node.m_next = m_head;
+                if (m_head != nullptr) m_head->m_prev = &node;
+                m_head = &node;
+                node.m_linked = true;
+                return true;
+            }
+
+            void remove(cancellation_node& node) noexcept
+            {
+                std::lock_guard lock(m_mutex);
+                if (node.m_linked) unlink(node);
+            }
+
+        private:
+            void unlink(cancellation_node& node) noexcept
+            {
+                if (node.m_prev != nullptr) node.m_prev->m_next = node.m_next;
+                else m_head = node.m_next;
+                if (node.m_next != nullptr) node.m_next->m_prev = node.m_prev;
+                node.m_prev = node.m_next = nullptr;
+                node.m_linked = false;
+            }
+
+            std::atomic<uint32_t> m_refs{ 1 };
+            std::atomic<bool> m_cancelled{ false };
+            std::recursive_mutex m_mutex;  // callbacks may register or unregister while the list is walked
+            cancellation_node* m_head{ nullptr };
+        };
+    }
+
+    /**
+     * Observes a `cancellation_source`. Cheap to copy, a default constructed token can never be cancelled.
+     * Tasks inherit the token of the task awaiting them, see `promise_base::set_continuation`.
+     */
+    class cancellation_token
+    {
+    public:
+        cancellation_token() noexcept = default;
+        cancellation_token(cancellation_token const& other) noexcept : m_state(other.m_state) { if (m_state) m_state->acquire(); }
+        cancellation_token(cancellation_token&& other) noexcept : m_state(std::exchange(other.m_state, nullptr)) { }
+
+        cancellation_token& operator=(cancellation_token const& other) noexcept
+        {
+            if (other.m_state) other.m_state->acquire();
+            if (m_state) m_state->release();
+            m_state = other.m_state;
+            return *this;
+        }
+
+        cancellation_token& operator=(cancellation_token&& other) noexcept
+        {
+            if (std::addressof(other) != this)
+            {
+                if (m_state) m_state->release();
+                m_state = std::exchange(other.m_state, nullptr);
+            }
+            return *this;
+        }
+
+        ~cancellation_token() { if (m_state) m_state->release(); }
+
+        bool can_be_cancelled() const noexcept { return m_state != nullptr; }
+        bool is_cancellation_requested() const noexcept { return m_state != nullptr && m_state->is_cancelled(); }
+
+        void throw_if_cancellation_requested() const
+        {
+            if (is_cancellation_requested()) throw operation_cancelled{ };
+        }
+
+    private:
+        friend class cancellation_source;
+        template<typename F>
+        friend class cancellation_callback;
+
+        explicit cancellation_token(detail::cancellation_state* state) noexcept : m_state(state) { m_state->acquire(); }
+
+        detail::cancellation_state* m_state{ nullptr };
+    };
+
+    // requests cancellation of every operation holding one of its tokens, each source is cancelled once
+    class cancellation_source
+    {
+    public:
+        cancellation_source() : m_state(new detail::cancellation_state) { }
+        ~cancellation_source() { m_state->release(); }
+
+        cancellation_source(cancellation_source const&) = delete;
+        cancellation_source& operator=(cancellation_source const&) = delete;
+
+        cancellation_token token() const noexcept { return cancellation_token{ m_state }; }
+
+        /**
+         * Runs the registered callbacks on this thread, the operations they cancel complete with a cancellation error.
+         * Operations bound to a `Loop` (timers, I/O waits) must be cancelled on the loop thread.
+         * Returns false if cancellation was requested before.
+         */
+        bool request_cancellation() noexcept
+        {
+            auto* state = m_state;
+            state->acquire();  // a callback may resume a coroutine that destroys this source
+            bool first = state->request();
+            state->release();
+            return first;
+        }
+
+        bool is_cancellation_requested() const noexcept { return m_state->is_cancelled(); }
+
+    private:
+        detail::cancellation_state* m_state;
+    };
+
+    /**
+     * Invokes `f()` once cancellation of `token` is requested, right away if it already was.
+     * Unregisters on destruction, which waits if `f` is running on another thread.
+     * `f` may destroy the callback object that invoked it, as long as it touches nothing of it afterwards.
+     */
+    template<typename F>
+    class cancellation_callback : private detail::cancellation_node
+    {
+    public:
+        cancellation_callback(cancellation_token token, F f) : m_token(std::move(token)), m_f(std::move(f))
+        {
+            m_invoke = [](detail::cancellation_node& node) noexcept { static_cast<cancellation_callback&>(node).m_f(); };
+            if (m_token.m_state != nullptr && !m_token.m_state->add(*this)) m_f();
+        }
+
+        ~cancellation_callback()
+        {
+            if (m_token.m_state != nullptr) m_token.m_state->remove(*this);
+        }
+
+        cancellation_callback(cancellation_callback const&) = delete;
+        cancellation_callback& operator=(cancellation_callback const&) = delete;
+
+    private:
+        cancellation_token m_token;
+        F m_f;
+    };
+
+    namespace detail
+    {
+        // the token of an awaiting task, an empty one for other coroutines
+        template<typename Promise>
+        cancellation_token cancellation_token_of(std::coroutine_handle<Promise> coroutine) noexcept
+        {
+            if constexpr (requires { coroutine.promise().get_cancellation_token(); })
+                return coroutine.promise().get_cancellation_token();
+            else
+                return { };
+        }
+    }
+}
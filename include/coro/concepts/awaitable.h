@@ -1,3 +1,5 @@
+#pragma once
+
 #include <coroutine>
 #include <type_traits>
 #include <concepts>
@@ -2,9 +2,36 @@
 
 #include <coroutine>
 #include <atomic>
+#include <concepts>
+#include <optional>
+#include <type_traits>
+
+#include "handle.h"
+#include "async_semaphore.h"
 
 namespace coro
 {
+    namespace detail
+    {
+        // `Loop`: runs handles on the loop thread, call it from there
+        template<typename S>
+        concept handle_scheduler = requires(S& s, handle& h) { s.call(h); };
+
+        // `thread_pool`: resumes coroutines on its workers
+        template<typename S>
+        concept coroutine_scheduler = requires(S& s, std::coroutine_handle<> c) { s.enqueue(c); };
+    }
+
+    // where `set` resumes the waiters when it does not resume them inline
+    template<typename S>
+    concept event_scheduler = detail::handle_scheduler<S> || detail::coroutine_scheduler<S>;
+
+    /**
+     * Manual reset event, every awaiter suspends until `set` and resumes once.
+     *
+     * `set()` resumes the waiters inline in FIFO order. `set(scheduler)` hands the whole waiter list over to a `Loop` or
+     * `thread_pool` instead and returns right away, so the setter neither stalls nor recurses when waiters set other events.
+     */
     class event
     {
     public:
@@ -15,6 +42,8 @@ namespace coro
         event& operator=(event&&) = delete;
 
         void set() noexcept;
+        template<event_scheduler Scheduler>
+        void set(Scheduler& scheduler);
         void reset() noexcept;
         bool is_set() const noexcept;
 
@@ -24,6 +53,9 @@ namespace coro
     private:
         friend class awaiter;
 
+        // detaches the waiters and reverses them into FIFO order, nullptr if there are none
+        awaiter* take_waiters() noexcept;
+
         /**
          * nullptr: not set
          * awaiter*: awaiters waiting on this event
@@ -39,9 +71,11 @@ namespace coro
 
         bool await_ready() const noexcept { return m_event.is_set(); }
 
-        bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> coroutine) noexcept
         {
             m_coroutine = coroutine;
+            if constexpr (std::is_base_of_v<handle, Promise>) m_task = &coroutine.promise();
             void const* set = &m_event;
             void* old = m_event.suspended_awaiter.load(std::memory_order_acquire);
             // stack push
@@ -52,7 +86,7 @@ namespace coro
             }
             // update old pointer if other threads write to suspended_awaiter, `this` is the new node
             while (!m_event.suspended_awaiter.compare_exchange_weak(old, this, std::memory_order_release, std::memory_order_acquire));
-            
+
             return true;
         }
 
@@ -61,39 +95,168 @@ namespace coro
     private:
         friend event;
 
+        template<event_scheduler Scheduler>
+        void schedule(Scheduler& scheduler)
+        {
+            if constexpr (detail::handle_scheduler<Scheduler>)
+            {
+                auto& h = m_handle.emplace(m_coroutine);
+                if (m_task != nullptr) h.copy_schedule(*m_task);
+                scheduler.call(h);
+            }
+            else
+                scheduler.enqueue(m_coroutine);
+        }
+
         event const& m_event;
         std::coroutine_handle<> m_coroutine { nullptr };
+        handle const* m_task{ nullptr };  // the awaiting task, whose class and deadline a Loop resumes it with
         awaiter* m_next{ nullptr };  // linked list as stack
+        std::optional<resume_handle> m_handle;  // only created when handed to a Loop, a handle id costs an atomic increment
     };
 
-    void event::set() noexcept
+    inline event::awaiter* event::take_waiters() noexcept
     {
         auto* old = suspended_awaiter.exchange(this, std::memory_order_acq_rel);
-        if (old != this)
+        if (old == this) return nullptr;
+
+        auto* waiter = static_cast<awaiter*>(old);
+        awaiter* head = nullptr;
+        while (waiter != nullptr)
         {
-            auto* waiter = static_cast<awaiter*>(old);
-            while (waiter != nullptr)
-            {
-                auto* next = waiter->m_next;
-                waiter->m_coroutine.resume();
-                waiter = next;
-            }
+            auto* next = waiter->m_next;
+            waiter->m_next = head;
+            head = waiter;
+            waiter = next;
+        }
+        return head;
+    }
+
+    inline void event::set() noexcept
+    {
+        auto* waiter = take_waiters();
+        while (waiter != nullptr)
+        {
+            auto* next = waiter->m_next;  // the awaiter is gone once its coroutine runs
+            waiter->m_coroutine.resume();
+            waiter = next;
         }
     }
 
-    void event::reset() noexcept
+    template<event_scheduler Scheduler>
+    void event::set(Scheduler& scheduler)
+    {
+        auto* waiter = take_waiters();
+        while (waiter != nullptr)
+        {
+            auto* next = waiter->m_next;
+            waiter->schedule(scheduler);
+            waiter = next;
+        }
+    }
+
+    inline void event::reset() noexcept
     {
         void* old = this;
         suspended_awaiter.compare_exchange_strong(old, nullptr, std::memory_order_acquire);
     }
 
-    bool event::is_set() const noexcept
+    inline bool event::is_set() const noexcept
     {
         return suspended_awaiter.load(std::memory_order_acquire) == this;
     }
 
-    event::awaiter event::operator co_await() const noexcept
+    inline event::awaiter event::operator co_await() const noexcept
     {
         return awaiter{ *this };
     }
-}
\ No newline at end of file
+
+    /**
+     * Auto reset event, `set` releases exactly one waiter (the longest waiting), or leaves the event set for the next
+     * awaiter if nobody waits, which consumes it. Setting a set event does nothing.
+     * A binary `async_semaphore`, awaiting a set event is a single atomic RMW.
+     */
+    class auto_reset_event
+    {
+    public:
+        explicit auto_reset_event(bool set = false) noexcept : m_semaphore(set ? 1 : 0) { }
+
+        void set() { m_semaphore.release_bounded(1); }
+        void reset() noexcept { (void)m_semaphore.try_acquire(); }
+        bool is_set() const noexcept { return m_semaphore.available() > 0; }
+
+        async_semaphore::acquire_awaiter operator co_await() noexcept { return m_semaphore.acquire_async(); }
+
+    private:
+        async_semaphore m_semaphore;
+    };
+
+    /**
+     * Single waiter, single use event: one exchange to set, one CAS to wait, no waiter list at all.
+     * Awaiting it from more than one coroutine at a time is not supported.
+     */
+    class oneshot_event
+    {
+    public:
+        oneshot_event() = default;
+        oneshot_event(oneshot_event const&) = delete;
+        oneshot_event(oneshot_event&&) = delete;
+        oneshot_event& operator=(oneshot_event const&) = delete;
+        oneshot_event& operator=(oneshot_event&&) = delete;
+
+        class awaiter
+        {
+        public:
+            explicit awaiter(oneshot_event& e) noexcept : m_event(e) { }
+
+            bool await_ready() const noexcept { return m_event.is_set(); }
+
+            template<typename Promise>
+            bool await_suspend(std::coroutine_handle<Promise> coroutine) noexcept
+            {
+                if constexpr (std::is_base_of_v<handle, Promise>) m_event.m_task = &coroutine.promise();  // published by the CAS
+                void* expected = nullptr;
+                return m_event.m_state.compare_exchange_strong(expected, coroutine.address(), std::memory_order_release, std::memory_order_acquire);
+            }
+
+            void await_resume() const noexcept { }
+
+        private:
+            oneshot_event& m_event;
+        };
+
+        awaiter operator co_await() noexcept { return awaiter{ *this }; }
+
+        // resumes the waiter inline if there is one
+        void set() noexcept
+        {
+            if (auto* waiter = m_state.exchange(this, std::memory_order_acq_rel); waiter != nullptr && waiter != this)
+                std::coroutine_handle<>::from_address(waiter).resume();
+        }
+
+        // hands the waiter to a `Loop` or `thread_pool` instead
+        template<event_scheduler Scheduler>
+        void set(Scheduler& scheduler)
+        {
+            auto* waiter = m_state.exchange(this, std::memory_order_acq_rel);
+            if (waiter == nullptr || waiter == this) return;
+
+            auto coroutine = std::coroutine_handle<>::from_address(waiter);
+            if constexpr (detail::handle_scheduler<Scheduler>)
+            {
+                auto& h = m_handle.emplace(coroutine);
+                if (m_task != nullptr) h.copy_schedule(*m_task);
+                scheduler.call(h);
+            }
+            else
+                scheduler.enqueue(coroutine);
+        }
+
+        bool is_set() const noexcept { return m_state.load(std::memory_order_acquire) == this; }
+
+    private:
+        std::atomic<void*> m_state{ nullptr };  // nullptr: not set, this: set, otherwise the waiting coroutine
+        handle const* m_task{ nullptr };  // the waiting task if it is one, see `event::awaiter`
+        std::optional<resume_handle> m_handle;
+    };
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace coro
+{
+    namespace detail
+    {
+        inline thread_local bool frame_pool_destroyed = false;
+
+        /**
+         * Per thread free lists of coroutine frames, one list per 64 byte size class.
+         * A frame freed on another thread (e.g. a task that hopped onto a thread_pool) simply moves to that thread's lists,
+         * lists are bounded so threads that mostly free do not hoard memory.
+         */
+        class frame_pool
+        {
+            static constexpr size_t granularity = 64;
+            static constexpr size_t classes = 32;  // frames up to 2 KiB are pooled
+            static constexpr size_t max_cached = 256;  // per class
+
+            struct block { block* next; };
+
+            struct free_list
+            {
+                block* head{ nullptr };
+                size_t size{ 0 };
+            };
+
+        public:
+            frame_pool() = default;
+            frame_pool(frame_pool const&) = delete;
+            frame_pool& operator=(frame_pool const&) = delete;
+
+            ~frame_pool()
+            {
+                for (auto& list : m_lists)
+                    while (list.head != nullptr)
+                        ::operator delete(std::exchange(list.head, list.head->next));
+                frame_pool_destroyed = true;
+            }
+
+            static frame_pool& local()
+            {
+                thread_local frame_pool pool;
+                return pool;
+            }
+
+            void* allocate(size_t n)
+            {
+                auto c = size_class(n);
+                if (c >= classes) return ::operator new(n);
+                auto& list = m_lists[c];
+                if (list.head == nullptr) return ::operator new((c + 1) * granularity);
+                list.size--;
+                return std::exchange(list.head, list.head->next);
+            }
+
+            void deallocate(void* p, size_t n) noexcept
+            {
+                auto c = size_class(n);
+                if (c >= classes || m_lists[c].size >= max_cached)
+                {
+                    ::operator delete(p);
+                    return;
+                }
+                auto& list = m_lists[c];
+                list.head = ::new (p) block{ list.head };
+                list.size++;
+            }
+
+        private:
+            static constexpr size_t size_class(size_t n) noexcept { return (n - 1) / granularity; }
+
+            free_list m_lists[classes];
+        };
+
+        inline std::atomic<std::pmr::memory_resource*> frame_resource{ nullptr };
+
+        // in front of every frame, remembers where the frame came from (nullptr: the thread-local pool)
+        struct alignas(std::max_align_t) frame_header
+        {
+            std::pmr::memory_resource* resource;
+        };
+
+        inline void* allocate_frame(size_t n, std::pmr::memory_resource* resource)
+        {
+            auto total = n + sizeof(frame_header);
+            void* p = resource != nullptr ? resource->allocate(total, alignof(frame_header)) : frame_pool::local().allocate(total);
+            return ::new (p) frame_header{ resource } + 1;
+        }
+
+        // adapts an arbitrary allocator, lives in the same allocation behind the frame
+        template<typename Alloc>
+        class frame_allocator_resource final : public std::pmr::memory_resource
+        {
+            using byte_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<std::byte>;
+
+        public:
+            frame_allocator_resource(Alloc const& alloc, size_t total) : m_alloc(alloc), m_total(total) { }
+
+            static void* allocate(size_t n, Alloc const& alloc)
+            {
+                auto offset = (n + sizeof(frame_header) + alignof(frame_allocator_resource) - 1) / alignof(frame_allocator_resource) * alignof(frame_allocator_resource);
+                auto total = offset + sizeof(frame_allocator_resource);
+                byte_allocator a(alloc);
+                auto* p = std::allocator_traits<byte_allocator>::allocate(a, total);
+                auto* resource = ::new (p + offset) frame_allocator_resource(alloc, total);
+                return ::new (p) frame_header{ resource } + 1;
+            }
+
+        private:
+            void* do_allocate(size_t, size_t) override { throw std::bad_alloc(); }  // never used
+
+            // releases the whole block including this adapter
+            void do_deallocate(void* p, size_t, size_t) override
+            {
+                byte_allocator a(std::move(m_alloc));
+                auto total = m_total;
+                this->~frame_allocator_resource();
+                std::allocator_traits<byte_allocator>::deallocate(a, static_cast<std::byte*>(p), total);
+            }
+
+            bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+            byte_allocator m_alloc;
+            size_t m_total;
+        };
+
+        template<typename T>
+        struct is_polymorphic_allocator : std::false_type { };
+
+        template<typename T>
+        struct is_polymorphic_allocator<std::pmr::polymorphic_allocator<T>> : std::true_type { };
+
+        // frame from a memory resource or an allocator passed with `std::allocator_arg`
+        template<typename Alloc>
+        void* allocate_frame_with(size_t n, Alloc const& alloc)
+        {
+            if constexpr (std::is_convertible_v<Alloc const&, std::pmr::memory_resource*>)
+                return allocate_frame(n, alloc);
+            else if constexpr (is_polymorphic_allocator<Alloc>::value)
+                return allocate_frame(n, alloc.resource());
+            else
+                return frame_allocator_resource<Alloc>::allocate(n, alloc);
+        }
+
+        inline void deallocate_frame(void* frame, size_t n) noexcept
+        {
+            auto* header = static_cast<frame_header*>(frame) - 1;
+            auto total = n + sizeof(frame_header);
+            if (header->resource != nullptr)
+                header->resource->deallocate(header, total, alignof(frame_header));
+            else if (frame_pool_destroyed)  // freed during thread exit
+                ::operator delete(header);
+            else
+                frame_pool::local().deallocate(header, total);
+        }
+
+        template<typename Alloc>
+        concept frame_allocator = std::is_convertible_v<Alloc const&, std::pmr::memory_resource*> || requires(Alloc alloc) { alloc.allocate(size_t{ 1 }); };
+
+        // the allocator following `std::allocator_arg`, type-erased for the duration of the allocation call
+        class frame_allocator_arg
+        {
+        public:
+            template<frame_allocator Alloc>
+            frame_allocator_arg(Alloc const& alloc) noexcept
+                : m_alloc(&alloc), m_allocate([](size_t n, void const* a) { return allocate_frame_with(n, *static_cast<Alloc const*>(a)); }) { }
+
+            void* allocate(size_t n) const { return m_allocate(n, m_alloc); }
+
+        private:
+            void const* m_alloc;
+            void* (*m_allocate)(size_t, void const*);
+        };
+
+        // binds a coroutine parameter the allocation functions do not care about
+        struct ignored_arg
+        {
+            ignored_arg() = default;
+
+            template<typename T>
+            ignored_arg(T const&) noexcept { }
+        };
+
+        /**
+         * Class-level allocation functions for promise types.
+         * A coroutine whose parameters start with `std::allocator_arg, alloc` (after the object for member functions)
+         * gets its frame from `alloc`, a `std::pmr::memory_resource*` or any allocator, which is stashed in the frame.
+         * Up to 8 further parameters are accepted. All other frames come from the thread-local pool or the resource set with `set_frame_resource`.
+         * The placement forms are deliberately not templates, GCC pairs function templates with the usual delete as a mismatch.
+         */
+        struct frame_allocation
+        {
+            static void* operator new(std::size_t n) { return allocate_frame(n, frame_resource.load(std::memory_order_acquire)); }
+
+            static void* operator new(std::size_t n, std::allocator_arg_t, frame_allocator_arg alloc,
+                ignored_arg = { }, ignored_arg = { }, ignored_arg = { }, ignored_arg = { },
+                ignored_arg = { }, ignored_arg = { }, ignored_arg = { }, ignored_arg = { })
+            {
+                return alloc.allocate(n);
+            }
+
+            // member functions, the object comes first
+            static void* operator new(std::size_t n, ignored_arg, std::allocator_arg_t, frame_allocator_arg alloc,
+                ignored_arg = { }, ignored_arg = { }, ignored_arg = { }, ignored_arg = { },
+                ignored_arg = { }, ignored_arg = { }, ignored_arg = { }, ignored_arg = { })
+            {
+                return alloc.allocate(n);
+            }
+
+            static void operator delete(void* frame, std::size_t n) noexcept { deallocate_frame(frame, n); }
+        };
+    }
+
+    // frames of tasks and generators created afterwards come from `resource`, nullptr restores the thread-local pools
+    inline void set_frame_resource(std::pmr::memory_resource* resource) noexcept
+    {
+        detail::frame_resource.store(resource, std::memory_order_release);
+    }
+
+    inline std::pmr::memory_resource* get_frame_resource() noexcept
+    {
+        return detail::frame_resource.load(std::memory_order_acquire);
+    }
+}
@@ -5,9 +5,29 @@
 #include <exception>
 #include <utility>
 #include <iterator>
+#include <memory>
+
+#include "frame_allocator.h"
 
 namespace coro
 {
+    // `co_yield elements_of(child)` yields every element of a nested generator (or any range) from the current one
+    template<typename R>
+    struct elements_of
+    {
+        R range;
+    };
+
+    template<typename R>
+    elements_of(R&&) -> elements_of<R&&>;
+
+    /**
+     * Synchronous lazy generator.
+     *
+     * Nested generators delegated to with `co_yield elements_of(child)` are resumed directly: the root promise keeps the
+     * innermost active frame and every frame knows its parent, so an element costs one resume at any nesting depth,
+     * a finished child transfers back to its parent symmetrically.
+     */
     template<typename T>
     struct generator
     {
@@ -18,27 +38,110 @@ namespace coro
         struct promise_type;
         using handle_type = std::coroutine_handle<promise_type>;
 
-        struct promise_type
+        struct promise_type : detail::frame_allocation  // pooled frames, `std::allocator_arg` aware
         {
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+                void await_resume() noexcept { }
+
+                // a nested generator continues its parent, the root returns to the iterator
+                std::coroutine_handle<> await_suspend(handle_type coroutine) noexcept
+                {
+                    auto& promise = coroutine.promise();
+                    if (promise.m_parent == nullptr) return std::noop_coroutine();
+                    promise.m_root->m_active = promise.m_parent;
+                    return promise.m_parent;
+                }
+            };
+
+            // yields a copy of a const lvalue, kept in the awaiter until the generator resumes
+            struct copy_awaiter : std::suspend_always
+            {
+                value_type m_copy;
+
+                void await_suspend(handle_type coroutine) noexcept { coroutine.promise().m_root->m_value = std::addressof(m_copy); }
+            };
+
+            // runs the child until its first yield, rethrows what escaped it once it finished
+            struct nested_awaiter
+            {
+                generator m_owned;  // empty when delegating to a borrowed generator
+                handle_type m_child;
+
+                bool await_ready() noexcept { return m_child == nullptr || m_child.done(); }  // a borrowed generator may be finished already
+
+                std::coroutine_handle<> await_suspend(handle_type coroutine) noexcept
+                {
+                    auto& child = m_child.promise();
+                    child.m_root = coroutine.promise().m_root;
+                    child.m_parent = coroutine;
+                    child.m_root->m_active = m_child;
+                    return m_child;
+                }
+
+                void await_resume()
+                {
+                    if (m_child != nullptr) m_child.promise().rethrow_if_exception();
+                }
+            };
+
             generator<T> get_return_object() noexcept { return generator<T>{ handle_type::from_promise(*this) }; }
 
             std::suspend_always initial_suspend() const noexcept { return { }; }
 
-            std::suspend_always final_suspend() const noexcept { return { }; }
+            final_awaiter final_suspend() const noexcept { return { }; }
 
             std::suspend_always yield_value(value_type&& value) noexcept
             {
-                m_value = std::addressof(value);
+                m_root->m_value = std::addressof(value);
+                return { };
+            }
+
+            // lvalues are yielded in place
+            std::suspend_always yield_value(value_type& value) noexcept
+                requires (!std::is_const_v<value_type>)
+            {
+                m_root->m_value = std::addressof(value);
                 return { };
             }
 
+            copy_awaiter yield_value(value_type const& value)
+                requires (!std::is_const_v<value_type>) && std::is_copy_constructible_v<value_type>
+            {
+                return copy_awaiter{ { }, value };
+            }
+
+            template<typename G>
+                requires std::is_same_v<std::remove_cvref_t<G>, generator>
+            nested_awaiter yield_value(elements_of<G> nested) noexcept
+            {
+                if constexpr (std::is_lvalue_reference_v<G>)
+                    return nested_awaiter{ { }, nested.range.m_coroutine };
+                else
+                {
+                    generator child{ std::move(nested.range) };
+                    auto handle = child.m_coroutine;
+                    return nested_awaiter{ std::move(child), handle };
+                }
+            }
+
+            // other ranges go through a generator over them, the range lives in the suspended co_yield expression
+            template<typename R>
+            nested_awaiter yield_value(elements_of<R> nested)
+            {
+                auto child = generator::yield_all<R>(std::forward<R>(nested.range));
+                auto handle = child.m_coroutine;
+                return nested_awaiter{ std::move(child), handle };
+            }
+
             void unhandled_exception() { m_exception = std::current_exception(); }
 
             void return_void() noexcept { }
 
             reference_type value() const noexcept
             {
-                return static_cast<reference_type>(*m_value);
+                return static_cast<reference_type>(*m_root->m_value);
             }
 
             void rethrow_if_exception()
@@ -47,9 +150,16 @@ namespace coro
                     std::rethrow_exception(m_exception);
             }
 
+            // resumes the innermost generator that is still running, call on the root
+            void resume() { m_active.resume(); }
+
         private:
-            pointer_type m_value{ nullptr };
+            pointer_type m_value{ nullptr };  // on the root only
             std::exception_ptr m_exception;
+
+            promise_type* m_root{ this };
+            handle_type m_parent{ nullptr };  // the generator delegating to this one
+            handle_type m_active{ handle_type::from_promise(*this) };  // on the root only, the innermost running frame
         };
 
         struct sentinel { };
@@ -61,7 +171,7 @@ namespace coro
 
             iterator() = default;
             explicit iterator(handle_type handle) noexcept : m_coroutine(handle) { }
-            
+
             friend bool operator==(iterator const& it, sentinel) noexcept { return it.m_coroutine == nullptr || it.m_coroutine.done(); }
 
             friend bool operator==(sentinel s, iterator const& it) noexcept { return (it == s); }
@@ -73,7 +183,7 @@ namespace coro
             // ++it
             iterator& operator++()
             {
-                m_coroutine.resume();
+                m_coroutine.promise().resume();
                 if (m_coroutine.done())
                     m_coroutine.promise().rethrow_if_exception();
                 return *this;
@@ -117,17 +227,24 @@ namespace coro
         {
             if (m_coroutine != nullptr)
             {
-                m_coroutine.resume();
+                m_coroutine.promise().resume();
                 if (m_coroutine.done())
                     m_coroutine.promise().rethrow_if_exception();
             }
-            
+
             return iterator{ m_coroutine };
         }
 
         sentinel end() noexcept { return { }; }
 
     private:
+        template<typename R>
+        static generator yield_all(R&& range)
+        {
+            for (auto&& element : range)
+                co_yield element;
+        }
+
         handle_type m_coroutine { nullptr };
     };
-}
\ No newline at end of file
+}
@@ -1,15 +1,30 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <coroutine>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <type_traits>
 
 namespace coro
 {
+    template<typename T>
+    class intrusive_mpsc_queue;
+
     using HandleID = uint64_t;
 
+    // scheduling classes of a Loop's ready queues, see `Loop::call(handle&, priority)`
+    enum class priority : uint8_t { high, normal, low };
+    inline constexpr size_t priority_classes = 3;
+
     class handle
     {
     public:
-        handle() : id(id_gen++) { }
+        handle() : id(id_gen.fetch_add(1, std::memory_order_relaxed)) { }
         virtual ~handle() = default;
         
         HandleID get_handle_id() { return id; }
@@ -17,14 +32,113 @@ namespace coro
         virtual void run() = 0;
         virtual void dump_backtrace(size_t) const { }
 
+        using deadline_type = std::chrono::steady_clock::time_point;
+        static constexpr deadline_type no_deadline = deadline_type::max();
+
+        /**
+         * Where a Loop queues this handle every time it becomes ready, not only on the first run: the class, and
+         * the deadline that takes precedence over it, see `Loop::call` and `Loop::call_with_deadline`.
+         */
+        priority get_priority() const noexcept { return m_priority; }
+        void set_priority(priority p) noexcept { m_priority = p; }
+        deadline_type get_deadline() const noexcept { return m_deadline; }
+        void set_deadline(deadline_type deadline) noexcept { m_deadline = deadline; }
+
+        // takes over the class and deadline of `other`, e.g. of the task an awaiter resumes
+        void copy_schedule(handle const& other) noexcept
+        {
+            m_priority = other.m_priority;
+            m_deadline = other.m_deadline;
+        }
+
+        // what a Loop calls: resumes a bound coroutine directly, no virtual call, and only falls back to `run`
+        void dispatch()
+        {
+            if (m_coroutine == nullptr) run();
+            else if (!m_coroutine.done()) m_coroutine.resume();
+        }
+
+    protected:
+        // for handles whose `run` is nothing but resuming `coroutine` (tasks, resume_handle)
+        void bind_coroutine(std::coroutine_handle<> coroutine) noexcept { m_coroutine = coroutine; }
+        std::coroutine_handle<> bound_coroutine() const noexcept { return m_coroutine; }
+
     private:
+        template<typename T>
+        friend class intrusive_mpsc_queue;
+
         HandleID id;
-        inline static HandleID id_gen = 0;
+        inline static std::atomic<HandleID> id_gen = 0;  // handles may be created on pool threads
+        handle* m_next{ nullptr };  // link in a Loop's thread-safe injection queue
+        std::coroutine_handle<> m_coroutine{ nullptr };
+        deadline_type m_deadline{ no_deadline };
+        priority m_priority{ priority::normal };
+    };
+
+    /**
+     * FIFO of ready handles in a power of two ring that only ever grows, so pushing does not allocate once warmed up.
+     * Contiguous on purpose: a list linked through the handles makes every pop wait for a load from the previous frame,
+     * which measured slower than the deque it replaces as soon as the frames fall out of L1.
+     * `T` is a handle pointer, or a small struct around one when the queue keeps something per entry.
+     */
+    template<typename T>
+    class basic_handle_queue
+    {
+    public:
+        void push(T h)
+        {
+            if (size() == m_items.size()) grow(m_items.size() * 2);
+            m_items[m_tail++ & (m_items.size() - 1)] = h;
+        }
+
+        T pop() noexcept { return m_items[m_head++ & (m_items.size() - 1)]; }
+
+        // room for `n` more handles, growing at most once, so that a batch is pushed without further checks
+        void reserve(size_t n)
+        {
+            if (m_items.size() - size() >= n) return;
+            grow(std::bit_ceil(size() + n));
+        }
+
+        bool empty() const noexcept { return m_head == m_tail; }
+        size_t size() const noexcept { return m_tail - m_head; }
+
+    private:
+        void grow(size_t capacity)
+        {
+            std::vector<T> items(std::max<size_t>(capacity, 64));
+            for (auto i = m_head; i != m_tail; i++) items[i & (items.size() - 1)] = m_items[i & (m_items.size() - 1)];
+            m_items.swap(items);
+        }
+
+        std::vector<T> m_items;
+        size_t m_head{ 0 };
+        size_t m_tail{ 0 };
+    };
+
+    using handle_queue = basic_handle_queue<handle*>;
+
+    // resumes a bare coroutine, lets awaiters enqueue their suspended coroutine like a task
+    class resume_handle : public handle
+    {
+    public:
+        explicit resume_handle(std::coroutine_handle<> coroutine = nullptr) { bind_coroutine(coroutine); }
+
+        void set_coroutine(std::coroutine_handle<> coroutine) noexcept { bind_coroutine(coroutine); }
+
+        // a task's coroutine is resumed with the task's class and deadline
+        template<typename Promise>
+        void set_coroutine(std::coroutine_handle<Promise> coroutine) noexcept
+        {
+            bind_coroutine(coroutine);
+            if constexpr (std::is_base_of_v<handle, Promise>) copy_schedule(coroutine.promise());
+        }
+        void run() override final { bound_coroutine().resume(); }
     };
 
     struct handle_wrapper
     {
         HandleID id;
-        handle* handle;
+        coro::handle* handle;
     };
 }
@@ -2,24 +2,72 @@
 
 #include "handle.h"
 #include "task.h"
-#include <queue>
+#include "timer.h"
+#include "reactor.h"
+#include "uring.h"
+#include "mpsc_queue.h"
+#include "metrics.h"
+#include "cancellation.h"
 #include <chrono>
+#include <thread>
+#include <optional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
+#include <ranges>
 #include <algorithm>
-#include <thread>
+#include <functional>
+#include <stdexcept>
+#if !defined(__linux__)
+#include <mutex>
+#include <condition_variable>
+#endif
 
 namespace coro
 {
     class Loop
     {
-        using MS = std::chrono::milliseconds;
-        using delayed_handle = std::pair<MS, handle_wrapper>;
+        using US = std::chrono::microseconds;
         using clock = std::chrono::steady_clock;
+#ifdef CORO_TIMER_HEAP
+        using timer_queue = timer_heap<handle_wrapper>;
+#else
+        using timer_queue = timing_wheel<handle_wrapper>;
+#endif
+
+        // an entry of the ready queues, with metrics also the time it was queued
+        struct ready_handle
+        {
+            handle* h;
+#if CORO_LOOP_METRICS
+            clock::time_point queued;
+#endif
+        };
+        using ready_queue = basic_handle_queue<ready_handle>;
+
+        // an entry of the earliest deadline first heap, `seq` keeps equal deadlines in call order
+        struct deadline_handle
+        {
+            clock::time_point deadline;
+            uint64_t seq;
+            ready_handle ready;
+
+            bool operator>(deadline_handle const& other) const noexcept
+            {
+                return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+            }
+        };
+
+        static constexpr size_t high_class = static_cast<size_t>(priority::high);
+        static constexpr size_t normal_class = static_cast<size_t>(priority::normal);
+        static constexpr size_t low_class = static_cast<size_t>(priority::low);
 
     public:
+        using clock_type = clock;
+
         Loop()
         {
-            startup_time = std::chrono::duration_cast<MS>(clock::now().time_since_epoch());
+            startup_time = std::chrono::duration_cast<US>(clock::now().time_since_epoch());
         }
         ~Loop() = default;
         Loop(Loop const&) = delete;
@@ -29,7 +77,7 @@ namespace coro
 
         void call(handle& _handle)
         {
-            handles.push({ _handle.get_handle_id(), &_handle });
+            enqueue(&_handle);
         }
 
         template<typename Ret>
@@ -38,54 +86,584 @@ namespace coro
             call(_task.promise());
         }
 
+        /**
+         * Every priority class has its own ready queue. While several classes have ready handles, an iteration
+         * serves them by weighted round-robin, see `set_priority_weights`, so a burst of `priority::low` work only
+         * gets its share of every round instead of delaying whatever is queued behind it. The class sticks to
+         * `_handle`: a task that suspends is queued in it again when a timer, I/O, an event or another thread
+         * wakes it up, and the tasks it awaits inherit it, see `promise_base::set_continuation`.
+         */
+        void call(handle& _handle, priority _priority)
+        {
+            _handle.set_priority(_priority);
+            enqueue(&_handle);
+        }
+
+        template<typename Ret>
+        void call(task<Ret>& _task, priority _priority)
+        {
+            call(_task.promise(), _priority);
+        }
+
+        /**
+         * Earliest deadline first: tagged handles run ahead of every priority class, the earliest deadline first,
+         * equal deadlines in call order. Tagging is the opt-in, untagged handles keep the class scheduling.
+         * Like the class, the deadline sticks to `_handle` and the tasks it awaits until it is set to
+         * `handle::no_deadline` again. A run that starts after the deadline still happens and counts as a miss.
+         */
+        void call_with_deadline(handle& _handle, clock::time_point deadline)
+        {
+            _handle.set_deadline(deadline);
+            enqueue(&_handle);
+        }
+
+        template<typename Ret>
+        void call_with_deadline(task<Ret>& _task, clock::time_point deadline)
+        {
+            call_with_deadline(_task.promise(), deadline);
+        }
+
+        // handles each class runs per round-robin round, { 16, 4, 1 } by default, every weight at least 1
+        void set_priority_weights(unsigned high, unsigned normal, unsigned low)
+        {
+            if (high == 0 || normal == 0 || low == 0) throw std::invalid_argument("priority weights must be positive");
+            weights[high_class] = high;
+            weights[normal_class] = normal;
+            weights[low_class] = low;
+        }
+
+        /**
+         * The loop takes ownership of `_task` and runs it detached, its frame is destroyed right at final_suspend,
+         * there is nothing to keep alive and nothing to collect afterwards. An exception escaping it is dropped.
+         * A detached task that is still suspended when the loop is destroyed is leaked.
+         */
+        template<typename Ret>
+        void spawn(task<Ret>&& _task)
+        {
+            if (auto* h = detach(std::move(_task))) enqueue(h);
+        }
+
+        /**
+         * Like `spawn`, but returns the handle to start the task with instead of queueing it, nullptr if there is
+         * nothing left to run. Only touches the task's frame, so another thread may detach a task it then hands
+         * over to this loop.
+         */
+        template<typename Ret>
+        handle* detach(task<Ret>&& _task)
+        {
+            auto h = _task.release();
+            if (h == nullptr) return nullptr;
+            if (h.done())
+            {
+                h.destroy();
+                return nullptr;
+            }
+            h.promise().set_completion_hook(&detached);
+            return &h.promise();
+        }
+
+        // spawns every task of `tasks` (e.g. a std::vector<task<>>), the ready queue grows at most once for the batch
+        template<typename Range>
+        void spawn_range(Range&& tasks)
+        {
+            ready[normal_class].reserve(static_cast<size_t>(std::ranges::distance(tasks)));
+            for (auto&& t : tasks)
+            {
+                if (auto* h = detach(std::move(t))) enqueue(h);
+            }
+        }
+
+        // safe from any thread, `_handle` runs on the loop thread in a later iteration
+        void call_threadsafe(handle& _handle)
+        {
+            if (!injected.push(&_handle)) return;  // not the first one, whoever was has taken care of the wakeup
+            std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in `poll`
+            if (parked.load(std::memory_order_relaxed))
+                wakeup();
+        }
+
+        template<typename Ret>
+        void call_threadsafe(task<Ret>& _task)
+        {
+            call_threadsafe(_task.promise());
+        }
+
+        /**
+         * A queue of handles the loop does not own, e.g. a ring another thread pushes into. Every added source
+         * is drained on each iteration, and is checked for emptiness before the loop parks: producers push,
+         * then call `wakeup_if_parked`, the same handshake as `call_threadsafe`.
+         */
+        struct handle_source
+        {
+            virtual void drain(Loop& loop) = 0;  // `loop.call` everything that is ready
+            virtual bool empty() const noexcept = 0;
+
+        protected:
+            ~handle_source() = default;
+        };
+
+        // loop thread only, `source` must outlive the loop or at least its last iteration
+        void add_source(handle_source& source) { sources.push_back(&source); }
+
+        // after pushing into a `handle_source` from another thread
+        void wakeup_if_parked()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in `poll`
+            if (parked.load(std::memory_order_relaxed))
+                wakeup();
+        }
+
+        // run `_handle` on the loop thread once `deadline` passed
+        timer_id call_at(clock::time_point deadline, handle& _handle)
+        {
+            auto t = std::chrono::ceil<US>(deadline.time_since_epoch()) - startup_time;
+            return delayed_handles.add(t, handle_wrapper{ _handle.get_handle_id(), &_handle });
+        }
+
+        template<typename Rep, typename Period>
+        timer_id call_after(std::chrono::duration<Rep, Period> delay, handle& _handle)
+        {
+            auto t = std::chrono::ceil<US>(delay) + now();
+            return delayed_handles.add(t, handle_wrapper{ _handle.get_handle_id(), &_handle });
+        }
+
+        // cancelling the task's cancellation token before the delay is up cancels the timer, the task never starts
         template<typename Rep, typename Period, typename Ret>
-        void call_after(std::chrono::duration<Rep, Period> delay, task<Ret>& _task)
+        timer_id call_after(std::chrono::duration<Rep, Period> delay, task<Ret>& _task)
+        {
+            auto handle_id = _task.promise().get_handle_id();
+            auto id = call_after(delay, static_cast<handle&>(_task.promise()));
+            if (auto const& token = _task.promise().get_cancellation_token(); token.can_be_cancelled())
+            {
+                if (token.is_cancellation_requested()) delayed_handles.cancel(id);
+                else timer_cancellations[handle_id] = std::make_unique<timer_cancellation>(token, timer_canceller{ this, id, handle_id });
+            }
+            return id;
+        }
+
+        // returns false if the timer already fired or was cancelled
+        bool cancel(timer_id id)
+        {
+            if (!timer_cancellations.empty())
+            {
+                if (auto const* h = delayed_handles.find(id)) timer_cancellations.erase(h->id);
+            }
+            return delayed_handles.cancel(id);
+        }
+
+        /**
+         * Suspends the awaiting coroutine on the timer queue, no task or allocation per sleep.
+         * Cancelling the token of the awaiting task cancels the timer, the coroutine resumes in the next iteration and throws `operation_cancelled`.
+         */
+        class sleep_awaiter
+        {
+        public:
+            sleep_awaiter(Loop& loop, clock::time_point deadline) noexcept : m_loop(loop), m_deadline(deadline) { }
+
+            bool await_ready() const noexcept { return false; }  // even a deadline in the past yields to the loop once
+
+            template<typename Promise>
+            bool await_suspend(std::coroutine_handle<Promise> coroutine)
+            {
+                auto token = detail::cancellation_token_of(coroutine);
+                if (token.is_cancellation_requested())
+                {
+                    m_cancelled = true;
+                    return false;
+                }
+                m_handle.set_coroutine(coroutine);
+                m_timer = m_loop.call_at(m_deadline, m_handle);
+                if (token.can_be_cancelled()) m_cancellation.emplace(std::move(token), canceller{ this });
+                return true;
+            }
+
+            void await_resume()
+            {
+                m_cancellation.reset();
+                if (m_cancelled) throw operation_cancelled{ };
+            }
+
+        private:
+            struct canceller
+            {
+                sleep_awaiter* m_awaiter;
+
+                void operator()() const noexcept
+                {
+                    auto& a = *m_awaiter;
+                    if (!a.m_loop.cancel(a.m_timer)) return;  // fired already, the coroutine is about to run
+                    a.m_cancelled = true;
+                    a.m_loop.call(a.m_handle);  // resumes in the next iteration, not inside the canceller
+                }
+            };
+
+            Loop& m_loop;
+            clock::time_point m_deadline;
+            timer_id m_timer;
+            bool m_cancelled{ false };
+            resume_handle m_handle;
+            std::optional<cancellation_callback<canceller>> m_cancellation;
+        };
+
+        // `co_await loop.sleep_for(10ms)`, resumes on the loop thread
+        template<typename Rep, typename Period>
+        sleep_awaiter sleep_for(std::chrono::duration<Rep, Period> delay) noexcept
         {
-            auto t = std::chrono::duration_cast<MS>(delay) + now();
-            delayed_handles.emplace_back(t, handle_wrapper{ _task.promise().get_handle_id(), &_task.promise() });
-            std::ranges::push_heap(delayed_handles, std::ranges::greater{}, &delayed_handle::first);  // min heap
+            return { *this, clock::now() + std::chrono::ceil<clock::duration>(delay) };
         }
 
+        sleep_awaiter sleep_until(clock::time_point deadline) noexcept { return { *this, deadline }; }
+
+#if defined(__linux__)
+        // suspend until `fd` is readable / writable, edge-triggered: read or write until EAGAIN before awaiting again
+        epoll_reactor::awaiter readable(int fd) noexcept { return { reactor, fd, io_event::read }; }
+        epoll_reactor::awaiter writable(int fd) noexcept { return { reactor, fd, io_event::write }; }
+
+        // call before closing a fd that was awaited
+        void forget(int fd) { reactor.remove(fd); }
+
+        // completion based read / write / accept / ... awaitables, io_uring when available
+        io_context& io() noexcept { return io_ctx; }
+#endif
+
         void run_until_complete()
         {
-            while(!is_stop()) run_once();
+            while (!is_stop()) run_once();
+        }
+
+        // keeps running, parked while there is nothing to do, until another thread calls `stop`
+        void run_until_stopped()
+        {
+            while (!stopping.load(std::memory_order_acquire)) run_once();
+            stopping.store(false, std::memory_order_relaxed);
+        }
+
+        // safe from any thread, `run_until_stopped` returns after the current iteration
+        void stop()
+        {
+            stopping.store(true, std::memory_order_release);
+            wakeup();
+        }
+
+#if CORO_LOOP_METRICS
+        // copy of the counters so far, call on the loop thread (e.g. from a periodic task)
+        loop_metrics metrics() const { return stats; }
+
+        void reset_metrics() { stats = { }; }
+
+        // also keep a run time histogram per handle id, unbounded, meant for debugging sessions
+        void track_handles(bool enable) { per_handle = enable; }
+#endif
+
+        // interrupt a parked loop, safe to call from other threads
+        void wakeup()
+        {
+#if defined(__linux__)
+            reactor.wakeup();
+#else
+            {
+                std::lock_guard lock(park_mutex);
+                woken = true;
+            }
+            park_cv.notify_one();
+#endif
         }
 
     private:
         bool is_stop()
         {
-            return handles.empty() && delayed_handles.empty();
+#if defined(__linux__)
+            if (reactor.waiting() != 0 || io_ctx.pending() != 0) return false;
+#endif
+            return ready_empty() && delayed_handles.empty() && injected.empty() && sources_empty();
+        }
+
+        bool sources_empty() const noexcept
+        {
+            for (auto* source : sources)
+            {
+                if (!source->empty()) return false;
+            }
+            return true;
         }
 
         void run_once()
         {
-            auto current = now();
-            while (!delayed_handles.empty())
+#if CORO_LOOP_METRICS
+            stats.iterations++;
+            stats.queue_depth.record(ready_size());
+#endif
+            poll();
+
+            // expire all due timers in one batch
+#if CORO_LOOP_METRICS
+            auto expiry = now();
+            stamp_time = clock::now();
+            stamp_valid = true;
+            delayed_handles.expire(expiry, [this, expiry](handle_wrapper h, US deadline) {
+                stats.timers_fired++;
+                stats.timer_lag.record(static_cast<uint64_t>(std::max<US::rep>((expiry - deadline).count(), 0)));
+                fire(h);
+            });
+#else
+            delayed_handles.expire(now(), [this](handle_wrapper h) { fire(h); });
+#endif
+
+            size_t n;
+            if (deadline_handles.empty() && ready[high_class].empty() && ready[low_class].empty())
             {
-                auto&& [t, h] = delayed_handles[0];
-                if (t >= current) break;
-                handles.push(h);
-                std::ranges::pop_heap(delayed_handles, std::ranges::greater{}, &delayed_handle::first);
-                delayed_handles.pop_back();
+                n = ready[normal_class].size();  // the common case, one FIFO
+                run_batch(normal_class, n);
             }
+            else
+                n = run_prioritized();
+#if CORO_LOOP_METRICS
+            stamp_valid = false;  // back to the caller
+            stats.handles_run += n;
+            stats.handles_per_iteration.record(n);
+#endif
+        }
 
-            for (size_t i = 0, n = handles.size(); i < n; i++)
+        /**
+         * Deadline tagged handles first, in deadline order, then weighted round-robin across the classes.
+         * Only as many handles run as were ready when the iteration started, the rest waits for the next one,
+         * so no class starves another for longer than an iteration.
+         */
+        size_t run_prioritized()
+        {
+            size_t left[priority_classes];
+            size_t n = 0;
+            for (size_t c = 0; c < priority_classes; c++) n += left[c] = ready[c].size();
+
+            auto due = deadline_handles.size();
+            n += due;
+#if CORO_LOOP_METRICS
+            auto start = clock::now();
+#endif
+            for (size_t i = 0; i < due; i++)
             {
-                auto [id, h] = handles.front();
-                handles.pop();
-                h->run();
+                std::pop_heap(deadline_handles.begin(), deadline_handles.end(), std::greater<>{ });
+                auto d = deadline_handles.back();
+                deadline_handles.pop_back();
+#if CORO_LOOP_METRICS
+                if (start > d.deadline) stats.deadline_misses++;
+                start = run(d.ready, stats.deadline_queue_delay, start);
+#else
+                d.ready.h->dispatch();
+#endif
             }
+
+            while (left[high_class] + left[normal_class] + left[low_class] != 0)
+            {
+                for (size_t c = 0; c < priority_classes; c++)
+                {
+                    auto k = std::min<size_t>(left[c], weights[c]);
+                    run_batch(c, k);
+                    left[c] -= k;
+                }
+            }
+            return n;
         }
 
-        MS now()
+        // runs the next `n` handles of class `c`
+        void run_batch(size_t c, size_t n)
         {
-            return std::chrono::duration_cast<MS>(clock::now().time_since_epoch()) - startup_time;
+            auto& queue = ready[c];
+#if CORO_LOOP_METRICS
+            if (n == 0) return;
+            auto start = clock::now();
+            for (size_t i = 0; i < n; i++) start = run(queue.pop(), stats.queue_delay[c], start);
+#else
+            for (size_t i = 0; i < n; i++) queue.pop().h->dispatch();
+#endif
         }
 
+#if CORO_LOOP_METRICS
+        // runs `r` from `start` on, records how long it was queued and ran, returns when it finished
+        clock::time_point run(ready_handle r, log_histogram& delay, clock::time_point start)
+        {
+            auto id = r.h->get_handle_id();  // `r.h` may be gone after running
+            delay.record(nanoseconds(start - r.queued));
+            stamp_time = start;
+            stamp_valid = true;
+            r.h->dispatch();
+            auto end = clock::now();
+            record_run(id, nanoseconds(end - start));
+            return end;
+        }
+
+        static uint64_t nanoseconds(clock::duration d) noexcept
+        {
+            return static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(), 0));
+        }
+#endif
+
+        // in the handle's own class, or by its deadline
+        void enqueue(handle* h)
+        {
+            if (h->get_priority() == priority::normal && h->get_deadline() == handle::no_deadline) [[likely]]
+                ready[normal_class].push(make_ready(h));
+            else
+                enqueue_scheduled(h);
+        }
+
+        // out of line, so that `enqueue` stays small enough to be inlined into every awaiter
+        [[gnu::noinline]] void enqueue_scheduled(handle* h)
+        {
+            if (auto deadline = h->get_deadline(); deadline != handle::no_deadline)
+            {
+                deadline_handles.push_back(deadline_handle{ deadline, deadline_seq++, make_ready(h) });
+                std::push_heap(deadline_handles.begin(), deadline_handles.end(), std::greater<>{ });
+            }
+            else
+                ready[static_cast<size_t>(h->get_priority())].push(make_ready(h));
+        }
+
+        /**
+         * The queue time is the last clock reading while it is known to be recent, e.g. the start of the running
+         * handle, so there is at most one clock read per batch of pushes and a delay is overstated by at most the
+         * run time of the handle that queued it. The reading is dropped wherever the loop may block or returns to
+         * the caller, handles queued from outside the loop count from the first one of their batch.
+         */
+        ready_handle make_ready(handle* h) noexcept
+        {
+#if CORO_LOOP_METRICS
+            if (!stamp_valid)
+            {
+                stamp_time = clock::now();
+                stamp_valid = true;
+            }
+            return { h, stamp_time };
+#else
+            return { h };
+#endif
+        }
+
+        size_t ready_size() const noexcept
+        {
+            size_t n = deadline_handles.size();
+            for (auto const& q : ready) n += q.size();
+            return n;
+        }
+
+        bool ready_empty() const noexcept
+        {
+            return deadline_handles.empty() && std::ranges::all_of(ready, [](ready_queue const& q) { return q.empty(); });
+        }
+
+        // destroys detached tasks as they complete, instead of resuming a continuation
+        struct reaper final : detail::completion_hook
+        {
+            std::coroutine_handle<> on_complete(detail::promise_base& child) noexcept override
+            {
+                child.coroutine().destroy();
+                return std::noop_coroutine();
+            }
+        };
+
+        void fire(handle_wrapper h)
+        {
+            enqueue(h.handle);
+            if (!timer_cancellations.empty()) timer_cancellations.erase(h.id);
+        }
+
+#if CORO_LOOP_METRICS
+        void record_run(HandleID id, uint64_t ns)
+        {
+            stats.run_time.record(ns);
+            if (per_handle) stats.run_time_by_handle[id].record(ns);
+        }
+#endif
+
+        US now()
+        {
+            return std::chrono::duration_cast<US>(clock::now().time_since_epoch()) - startup_time;
+        }
+
+        // wait for I/O, blocking only while nothing is ready and at most until the next timer
+        void poll()
+        {
+            // announce the park before the last look at the injection queue, producers only wake a parked loop
+            parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+#if CORO_LOOP_METRICS
+            stamp_valid = false;  // handles woken by I/O or other threads are stamped after the wait
+#endif
+            bool idle = ready_empty() && injected.empty() && sources_empty();
+
+            std::optional<clock::time_point> deadline;
+            if (!idle) deadline = clock::time_point{ };  // already passed, don't block
+            else if (auto next = delayed_handles.next_deadline()) deadline = clock::time_point(startup_time + *next);
+
+#if defined(__linux__)
+            auto push = [this](handle_wrapper h) { enqueue(h.handle); };
+            io_ctx.submit();  // everything queued during the last iteration, one syscall
+            if (io_ctx.unsubmitted() != 0) deadline = clock::time_point{ };  // the kernel refused some, retry next iteration
+            if (idle || reactor.waiting() != 0)  // no epoll syscall while only running handles
+                reactor.wait(deadline, push);
+            io_ctx.reap(push);
+#else
+            if (idle)
+            {
+                std::unique_lock lock(park_mutex);
+                if (deadline) park_cv.wait_until(lock, *deadline, [this] { return woken; });
+                else park_cv.wait(lock, [this] { return woken; });
+                woken = false;
+            }
+#endif
+            parked.store(false, std::memory_order_relaxed);
+
+            // everything handed over by other threads, in one batch
+            injected.consume_all([this](handle* h) { enqueue(h); });
+            for (auto* source : sources) source->drain(*this);
+        }
+
+        // cancels a `call_after` timer when the task's token is cancelled
+        struct timer_canceller
+        {
+            Loop* loop;
+            timer_id id;
+            HandleID handle_id;
+
+            void operator()() const noexcept
+            {
+                auto& cancellations = loop->timer_cancellations;
+                auto key = handle_id;  // copied, erasing destroys this callback
+                loop->delayed_handles.cancel(id);
+                cancellations.erase(key);
+            }
+        };
+        using timer_cancellation = cancellation_callback<timer_canceller>;
+
     private:
-        std::queue<handle_wrapper> handles;
+        reaper detached;  // the completion hook of every spawned task
+        ready_queue ready[priority_classes];  // tasks are resumed without a virtual call
+        unsigned weights[priority_classes]{ 16, 4, 1 };
+        std::vector<deadline_handle> deadline_handles;  // min-heap on (deadline, seq)
+        uint64_t deadline_seq{ 0 };
+        intrusive_mpsc_queue<handle> injected;  // from `call_threadsafe`
+        std::vector<handle_source*> sources;  // from `add_source`
+        std::atomic<bool> parked{ false };
+        std::atomic<bool> stopping{ false };
+
+        US startup_time;
+        timer_queue delayed_handles;  // timing wheel, or minimum time heap with CORO_TIMER_HEAP
+        std::unordered_map<HandleID, std::unique_ptr<timer_cancellation>> timer_cancellations;  // pending timers with a token
+
+#if CORO_LOOP_METRICS
+        loop_metrics stats;
+        bool per_handle{ false };
+        bool stamp_valid{ false };  // see `make_ready`
+        clock::time_point stamp_time;
+#endif
 
-        MS startup_time;
-        std::vector<delayed_handle> delayed_handles;  // minimum time heap
+#if defined(__linux__)
+        epoll_reactor reactor;  // also parks the loop until the next timer
+        io_context io_ctx{ reactor };
+#else
+        std::mutex park_mutex;
+        std::condition_variable park_cv;
+        bool woken{ false };  // guarded by park_mutex
+#endif
     };
 }
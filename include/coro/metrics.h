@@ -0,0 +1,84 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <unordered_map>
+
+#include "handle.h"
+
+// runtime counters of Loop, see `Loop::metrics`, off by default so the uninstrumented loop pays nothing,
+// define CORO_LOOP_METRICS=1 to compile them in
+#ifndef CORO_LOOP_METRICS
+#define CORO_LOOP_METRICS 0
+#endif
+
+namespace coro
+{
+    /**
+     * Histogram with power-of-two buckets: bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i).
+     * Recording is a bit scan and a few increments, percentiles are accurate to a factor of two.
+     */
+    struct log_histogram
+    {
+        static constexpr size_t bucket_count = 65;
+
+        uint64_t buckets[bucket_count]{ };
+        uint64_t count{ 0 };
+        uint64_t sum{ 0 };
+        uint64_t max{ 0 };
+
+        void record(uint64_t value) noexcept
+        {
+            buckets[std::bit_width(value)]++;
+            count++;
+            sum += value;
+            max = std::max(max, value);
+        }
+
+        double mean() const noexcept { return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count); }
+
+        // upper bound of the bucket holding the `p` quantile, `p` in [0, 1]
+        uint64_t percentile(double p) const noexcept
+        {
+            if (count == 0) return 0;
+            auto rank = static_cast<uint64_t>(p * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; i++)
+            {
+                seen += buckets[i];
+                if (seen >= rank) return i == 0 ? 0 : std::min(max, (i == 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << i) - 1));
+            }
+            return max;
+        }
+
+        void merge(log_histogram const& other) noexcept
+        {
+            for (size_t i = 0; i < bucket_count; i++) buckets[i] += other.buckets[i];
+            count += other.count;
+            sum += other.sum;
+            max = std::max(max, other.max);
+        }
+    };
+
+    // snapshot of a Loop's counters, see `Loop::metrics`
+    struct loop_metrics
+    {
+        uint64_t iterations{ 0 };
+        uint64_t handles_run{ 0 };
+        uint64_t timers_fired{ 0 };
+
+        log_histogram queue_depth;  // ready handles at the start of an iteration
+        log_histogram handles_per_iteration;
+        log_histogram timer_lag;  // microseconds from deadline to expiry
+        log_histogram run_time;  // nanoseconds per `handle::run()`
+
+        log_histogram queue_delay[priority_classes];  // nanoseconds from being queued to running, per priority class
+        log_histogram deadline_queue_delay;  // the same for `Loop::call_with_deadline`
+        uint64_t deadline_misses{ 0 };  // deadline tagged handles that started after their deadline
+
+        // per handle run time, only collected after `Loop::track_handles(true)`
+        std::unordered_map<HandleID, log_histogram> run_time_by_handle;
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace coro
+{
+    /**
+     * Lock-free intrusive multi-producer single-consumer queue.
+     * Producers push onto a Treiber stack through `T::m_next`, the consumer takes the whole stack with one exchange
+     * and reverses it, so a batch costs one atomic operation and comes out in FIFO order. Nodes are never allocated.
+     */
+    template<typename T>
+    class intrusive_mpsc_queue
+    {
+    public:
+        intrusive_mpsc_queue() = default;
+        intrusive_mpsc_queue(intrusive_mpsc_queue const&) = delete;
+        intrusive_mpsc_queue& operator=(intrusive_mpsc_queue const&) = delete;
+
+        // any thread, returns true if the queue was empty
+        bool push(T* node) noexcept
+        {
+            auto* head = m_head.load(std::memory_order_relaxed);
+            do
+            {
+                node->m_next = head;
+            }
+            while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+            return head == nullptr;
+        }
+
+        // consumer only, detach every node pushed so far and pass them to `f(T*)` oldest first, returns the batch size
+        template<typename F>
+        size_t consume_all(F&& f)
+        {
+            auto* node = m_head.exchange(nullptr, std::memory_order_acquire);
+            T* reversed = nullptr;
+            while (node != nullptr)
+            {
+                auto* next = node->m_next;
+                node->m_next = reversed;
+                reversed = node;
+                node = next;
+            }
+
+            size_t n = 0;
+            while (reversed != nullptr)
+            {
+                auto* next = std::exchange(reversed->m_next, nullptr);  // `f` may push the node again
+                f(reversed);
+                reversed = next;
+                n++;
+            }
+            return n;
+        }
+
+        bool empty() const noexcept { return m_head.load(std::memory_order_acquire) == nullptr; }
+
+    private:
+        std::atomic<T*> m_head{ nullptr };
+    };
+}
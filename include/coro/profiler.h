@@ -0,0 +1,208 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fmt/core.h>
+
+#include "task.h"
+
+namespace coro
+{
+    /**
+     * Sampling profiler of logical async stacks.
+     *
+     * While started, a per thread CPU-time timer sends SIGPROF to the thread that called `start`,
+     * the handler copies the continuation chain of the task running at that moment into a preallocated ring.
+     * `collect` drains the ring into Brendan Gregg's folded-stack format (`root;caller;leaf count`),
+     * which `folded` and `dump` export for flamegraph.pl or speedscope.
+     * Samples arriving while the ring is full are dropped and counted, collect regularly on long runs.
+     * Frames are named after the function of their last `co_await`, so CORO_TRACING is required.
+     */
+    class async_profiler
+    {
+        static_assert(CORO_TRACING, "async_profiler needs CORO_TRACING");
+
+        static constexpr size_t max_depth = 32;  // deeper stacks are truncated at the root side
+
+        struct sample_slot
+        {
+            size_t depth;
+            std::source_location frames[max_depth];  // leaf first
+        };
+
+    public:
+        explicit async_profiler(std::chrono::microseconds interval = std::chrono::milliseconds(1), size_t capacity = 4096)
+            : m_interval(interval), m_capacity(capacity), m_ring(std::make_unique<sample_slot[]>(capacity)) { }
+
+        ~async_profiler() { stop(); }
+
+        async_profiler(async_profiler const&) = delete;
+        async_profiler(async_profiler&&) = delete;
+        async_profiler& operator=(async_profiler const&) = delete;
+        async_profiler& operator=(async_profiler&&) = delete;
+
+        // start sampling the calling thread, one profiler per thread
+        void start()
+        {
+            if (m_running) return;
+            if (current_profiler != nullptr) throw std::logic_error("another async_profiler is running on this thread");
+            install_handler();
+
+            sigevent event{ };
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+            event._sigev_un._tid = static_cast<pid_t>(::syscall(SYS_gettid));
+            if (::timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &m_timer) < 0) throw_errno("timer_create");
+
+            auto us = m_interval.count();
+            itimerspec spec{ };
+            spec.it_interval.tv_sec = static_cast<time_t>(us / 1000000);
+            spec.it_interval.tv_nsec = static_cast<long>(us % 1000000 * 1000);
+            spec.it_value = spec.it_interval;
+            current_profiler = this;
+            m_running = true;
+            if (::timer_settime(m_timer, 0, &spec, nullptr) < 0)
+            {
+                stop();
+                throw_errno("timer_settime");
+            }
+        }
+
+        // must be called on the sampled thread
+        void stop() noexcept
+        {
+            if (!m_running) return;
+            ::timer_delete(m_timer);
+            current_profiler = nullptr;
+            m_running = false;
+        }
+
+        // record the logical stack of the running task now, async-signal-safe
+        void sample() noexcept
+        {
+            auto head = m_head.load(std::memory_order_relaxed);
+            if (head - m_tail.load(std::memory_order_acquire) >= m_capacity)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            auto& slot = m_ring[head % m_capacity];
+            slot.depth = 0;
+            for (auto* p = static_cast<detail::promise_base const*>(detail::current_promise.load(std::memory_order_relaxed)); p != nullptr && slot.depth < max_depth; p = p->caller())
+                slot.frames[slot.depth++] = p->get_frame_info();
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        // move pending samples into the folded stacks, samples outside any task are counted as "[idle]"
+        void collect()
+        {
+            auto head = m_head.load(std::memory_order_acquire);
+            for (auto tail = m_tail.load(std::memory_order_relaxed); tail != head; tail++)
+            {
+                auto const& slot = m_ring[tail % m_capacity];
+                std::string stack;
+                for (auto i = slot.depth; i > 0; i--)
+                {
+                    if (!stack.empty()) stack += ';';
+                    append_frame(stack, slot.frames[i - 1]);
+                }
+                if (stack.empty()) stack = "[idle]";
+                m_stacks[std::move(stack)]++;
+                m_tail.store(tail + 1, std::memory_order_release);
+            }
+        }
+
+        // folded stacks, one `frame;frame;... count` line each
+        std::string folded()
+        {
+            collect();
+            std::string out;
+            for (auto const& [stack, count] : m_stacks)
+            {
+                out += stack;
+                out += ' ';
+                out += std::to_string(count);
+                out += '\n';
+            }
+            return out;
+        }
+
+        void dump(std::FILE* file)
+        {
+            collect();
+            for (auto const& [stack, count] : m_stacks)
+                fmt::print(file, "{} {}\n", stack, count);
+        }
+
+        std::map<std::string, size_t> const& stacks() { collect(); return m_stacks; }
+
+        size_t dropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+        void clear()
+        {
+            collect();
+            m_stacks.clear();
+            m_dropped.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        static void append_frame(std::string& stack, std::source_location const& frame)
+        {
+            for (auto const* c = frame.function_name(); *c != '\0'; c++)
+                stack += *c == ';' ? ':' : *c;  // ';' separates frames
+        }
+
+        static void install_handler()
+        {
+            static bool installed = [] {
+                struct sigaction action{ };
+                action.sa_handler = [](int) {
+                    auto saved = errno;
+                    if (auto* p = current_profiler) p->sample();
+                    errno = saved;
+                };
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART;
+                if (::sigaction(SIGPROF, &action, nullptr) < 0) throw_errno("sigaction");
+                return true;
+            }();
+            (void)installed;
+        }
+
+        [[noreturn]] static void throw_errno(char const* what)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+
+    private:
+        std::chrono::microseconds m_interval;
+        size_t m_capacity;
+        std::unique_ptr<sample_slot[]> m_ring;
+        std::atomic<size_t> m_head{ 0 };  // written by `sample`
+        std::atomic<size_t> m_tail{ 0 };  // written by `collect`
+        std::atomic<size_t> m_dropped{ 0 };
+        std::map<std::string, size_t> m_stacks;
+
+        timer_t m_timer{ };
+        bool m_running{ false };
+
+        inline static thread_local async_profiler* current_profiler = nullptr;
+    };
+}
+
+#endif
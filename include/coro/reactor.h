@@ -0,0 +1,316 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "handle.h"
+#include "cancellation.h"
+
+namespace coro
+{
+    enum class io_event : uint8_t { read = 0, write = 1 };
+
+    /**
+     * Edge-triggered epoll reactor.
+     *
+     * A fd is registered for both directions on its first wait and stays registered until `remove`.
+     * Edges that arrive without a waiter are remembered and consumed by the next wait on that direction,
+     * so callers should do I/O until EAGAIN before awaiting.
+     * Timer deadlines are armed on a timerfd, so one epoll_wait covers I/O, timers and wakeups with microsecond precision.
+     */
+    class epoll_reactor
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr int max_events = 256;
+
+        struct fd_state
+        {
+            bool registered{ false };
+            bool watched{ false };  // only wakes `wait`, see `watch`
+            bool ready[2]{ false, false };
+            handle* waiter[2]{ nullptr, nullptr };
+        };
+
+    public:
+        epoll_reactor()
+        {
+            m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            if (m_epoll < 0) throw_errno("epoll_create1");
+            m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_wakeup < 0) throw_errno("eventfd");
+            m_timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);  // same clock as steady_clock
+            if (m_timer < 0) throw_errno("timerfd_create");
+
+            // level triggered, drained when reported
+            control(EPOLL_CTL_ADD, m_wakeup, EPOLLIN);
+            control(EPOLL_CTL_ADD, m_timer, EPOLLIN);
+        }
+
+        ~epoll_reactor()
+        {
+            ::close(m_timer);
+            ::close(m_wakeup);
+            ::close(m_epoll);
+        }
+
+        epoll_reactor(epoll_reactor const&) = delete;
+        epoll_reactor(epoll_reactor&&) = delete;
+        epoll_reactor& operator=(epoll_reactor const&) = delete;
+        epoll_reactor& operator=(epoll_reactor&&) = delete;
+
+        /**
+         * Cancelling the token of the awaiting task drops the wait, the task resumes in the next loop iteration
+         * and `await_resume` throws `operation_cancelled`. An edge that already arrived wins over the cancellation.
+         */
+        class awaiter
+        {
+        public:
+            awaiter(epoll_reactor& reactor, int fd, io_event event) noexcept : m_reactor(reactor), m_fd(fd), m_event(event) { }
+
+            bool await_ready() noexcept { return m_reactor.consume_ready(m_fd, m_event); }
+
+            template<typename Promise>
+            bool await_suspend(std::coroutine_handle<Promise> coroutine)
+            {
+                auto token = detail::cancellation_token_of(coroutine);
+                if (token.is_cancellation_requested())
+                {
+                    m_cancelled = true;
+                    return false;
+                }
+                m_handle.set_coroutine(coroutine);
+                m_reactor.add_waiter(m_fd, m_event, m_handle);
+                if (token.can_be_cancelled()) m_cancellation.emplace(std::move(token), canceller{ this });
+                return true;
+            }
+
+            void await_resume()
+            {
+                m_cancellation.reset();
+                if (m_cancelled) throw operation_cancelled{ };
+            }
+
+        private:
+            struct canceller
+            {
+                awaiter* m_awaiter;
+
+                void operator()() const noexcept
+                {
+                    auto& a = *m_awaiter;
+                    if (!a.m_reactor.cancel_waiter(a.m_fd, a.m_event)) return;  // already signalled, or not suspended yet
+                    a.m_cancelled = true;
+                }
+            };
+
+            epoll_reactor& m_reactor;
+            int m_fd;
+            io_event m_event;
+            bool m_cancelled{ false };
+            resume_handle m_handle;
+            std::optional<cancellation_callback<canceller>> m_cancellation;
+        };
+
+        // true if an edge on `fd` arrived while nobody was waiting, the edge is consumed
+        bool consume_ready(int fd, io_event event) noexcept
+        {
+            if (fd < 0 || static_cast<size_t>(fd) >= m_fds.size()) return false;
+            return std::exchange(m_fds[static_cast<size_t>(fd)].ready[static_cast<size_t>(event)], false);
+        }
+
+        // `h` is handed to `wait`'s callback once `fd` becomes ready in the `event` direction
+        void add_waiter(int fd, io_event event, handle& h)
+        {
+            if (fd < 0) throw std::invalid_argument("invalid file descriptor");
+            if (static_cast<size_t>(fd) >= m_fds.size()) m_fds.resize(static_cast<size_t>(fd) + 1);
+
+            auto& state = m_fds[static_cast<size_t>(fd)];
+            auto& waiter = state.waiter[static_cast<size_t>(event)];
+            if (waiter != nullptr) throw std::logic_error("another coroutine is already waiting on this fd");
+            if (!state.registered)
+            {
+                control(EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+                state.registered = true;
+            }
+            waiter = &h;
+            m_waiting++;
+        }
+
+        // drop the waiter of one direction without resuming it, the fd stays registered, false if there is none
+        bool remove_waiter(int fd, io_event event) noexcept
+        {
+            if (fd < 0 || static_cast<size_t>(fd) >= m_fds.size()) return false;
+            auto& waiter = m_fds[static_cast<size_t>(fd)].waiter[static_cast<size_t>(event)];
+            if (waiter == nullptr) return false;
+            waiter = nullptr;
+            m_waiting--;
+            return true;
+        }
+
+        /**
+         * Like `remove_waiter`, but the waiter is handed to the next `wait`'s callback as if `fd` became ready,
+         * so a cancelled coroutine resumes on the loop's normal path instead of inside the canceller.
+         */
+        bool cancel_waiter(int fd, io_event event)
+        {
+            if (fd < 0 || static_cast<size_t>(fd) >= m_fds.size()) return false;
+            auto& waiter = m_fds[static_cast<size_t>(fd)].waiter[static_cast<size_t>(event)];
+            if (waiter == nullptr) return false;
+            m_cancelled.push_back(std::exchange(waiter, nullptr));  // still counted in `waiting` until delivered
+            return true;
+        }
+
+        // deregister `fd` and drop its waiters, must be called before closing a fd that was awaited
+        void remove(int fd)
+        {
+            if (fd < 0 || static_cast<size_t>(fd) >= m_fds.size()) return;
+            auto& state = m_fds[static_cast<size_t>(fd)];
+            if (state.registered)
+                ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+            for (auto* w : state.waiter)
+                if (w != nullptr) m_waiting--;
+            state = { };
+        }
+
+        // level-triggered registration of `fd` that only interrupts `wait`, the owner handles the readiness itself
+        void watch(int fd)
+        {
+            if (fd < 0) throw std::invalid_argument("invalid file descriptor");
+            if (static_cast<size_t>(fd) >= m_fds.size()) m_fds.resize(static_cast<size_t>(fd) + 1);
+            control(EPOLL_CTL_ADD, fd, EPOLLIN);
+            m_fds[static_cast<size_t>(fd)].watched = true;
+        }
+
+        void unwatch(int fd)
+        {
+            if (fd < 0 || static_cast<size_t>(fd) >= m_fds.size() || !m_fds[static_cast<size_t>(fd)].watched) return;
+            ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+            m_fds[static_cast<size_t>(fd)] = { };
+        }
+
+        // number of suspended waiters
+        size_t waiting() const noexcept { return m_waiting; }
+
+        // interrupt a blocking `wait`, safe to call from other threads
+        void wakeup() noexcept
+        {
+            uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(m_wakeup, &one, sizeof(one));
+        }
+
+        /**
+         * Wait for I/O until `deadline`, forever if empty, and pass a handle_wrapper of every resumed waiter to `ready`.
+         * Returns the number of resumed waiters.
+         */
+        template<typename F>
+        size_t wait(std::optional<clock::time_point> deadline, F&& ready)
+        {
+            int timeout = -1;
+            if (!m_cancelled.empty()) timeout = 0;
+            else if (deadline)
+            {
+                if (*deadline <= clock::now()) timeout = 0;
+                else arm(*deadline);
+            }
+
+            epoll_event events[max_events];
+            int n = ::epoll_wait(m_epoll, events, max_events, timeout);
+            if (n < 0)
+            {
+                if (errno == EINTR) return 0;
+                throw_errno("epoll_wait");
+            }
+
+            size_t resumed = 0;
+            for (int i = 0; i < n; i++)
+            {
+                int fd = events[i].data.fd;
+                auto flags = events[i].events;
+                if (fd == m_wakeup || fd == m_timer)
+                {
+                    drain(fd);
+                    continue;
+                }
+                if (m_fds[static_cast<size_t>(fd)].watched) continue;
+                if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) resumed += signal(fd, io_event::read, ready);
+                if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) resumed += signal(fd, io_event::write, ready);
+            }
+
+            for (auto* h : m_cancelled) ready(handle_wrapper{ h->get_handle_id(), h });
+            resumed += m_cancelled.size();
+            m_waiting -= m_cancelled.size();
+            m_cancelled.clear();
+            return resumed;
+        }
+
+    private:
+        template<typename F>
+        size_t signal(int fd, io_event event, F& ready)
+        {
+            auto& state = m_fds[static_cast<size_t>(fd)];
+            auto*& waiter = state.waiter[static_cast<size_t>(event)];
+            if (waiter == nullptr)
+            {
+                state.ready[static_cast<size_t>(event)] = true;  // remember the edge
+                return 0;
+            }
+            ready(handle_wrapper{ waiter->get_handle_id(), std::exchange(waiter, nullptr) });
+            m_waiting--;
+            return 1;
+        }
+
+        void arm(clock::time_point deadline)
+        {
+            if (deadline == m_armed) return;
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+            itimerspec spec{ };
+            spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+            spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+            if (::timerfd_settime(m_timer, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) throw_errno("timerfd_settime");
+            m_armed = deadline;
+        }
+
+        void drain(int fd) noexcept
+        {
+            uint64_t value;
+            [[maybe_unused]] auto n = ::read(fd, &value, sizeof(value));
+        }
+
+        void control(int op, int fd, uint32_t events)
+        {
+            epoll_event ev{ };
+            ev.events = events;
+            ev.data.fd = fd;
+            if (::epoll_ctl(m_epoll, op, fd, &ev) < 0) throw_errno("epoll_ctl");
+        }
+
+        [[noreturn]] static void throw_errno(char const* what)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+
+    private:
+        int m_epoll{ -1 };
+        int m_wakeup{ -1 };  // eventfd
+        int m_timer{ -1 };  // timerfd
+        clock::time_point m_armed{ };
+        std::vector<fd_state> m_fds;  // indexed by fd
+        size_t m_waiting{ 0 };
+        std::vector<handle*> m_cancelled;  // from `cancel_waiter`, delivered by the next `wait`
+    };
+}
+
+#endif
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "task.h"
+#include "loop.h"
+#include "spsc_queue.h"
+
+namespace coro
+{
+    struct shard_options
+    {
+        size_t shards{ std::max(1u, std::thread::hardware_concurrency()) };
+        bool pin{ true };  // Linux only, elsewhere placement is left to the OS
+        std::vector<int> cpus{ };  // shard i runs on cpus[i % size], empty: the i-th cpu the process may run on, modulo their count
+        size_t ring_capacity{ 1024 };  // handles in flight per pair of shards before falling back to `call_threadsafe`
+    };
+
+    /**
+     * Thread-per-core runtime, one `Loop` per shard on its own thread, optionally pinned to a cpu.
+     * Shards share nothing, every shard has its own ready queue, timers, reactor and frame pools.
+     * Work moves between shards as handles through one lock-free SPSC ring per ordered pair of shards,
+     * which the receiving loop drains on every iteration.
+     *
+     *     sharded_runtime rt{ { .shards = 4 } };
+     *     auto n = co_await rt.submit_to(key % rt.size(), lookup(key));  // resumes back on the calling shard
+     *
+     * Threads outside the runtime may submit too, their handles go through the target loop's `call_threadsafe`.
+     * Cancellation tokens are not carried across shards: a token belongs to the tasks of one thread.
+     */
+    class sharded_runtime
+    {
+        struct shard final : Loop::handle_source
+        {
+            Loop loop;
+            std::vector<std::unique_ptr<spsc_queue<handle*>>> inbox;  // indexed by the sending shard, none from itself
+            std::thread thread;
+
+            void drain(Loop& l) override
+            {
+                for (auto& ring : inbox)
+                {
+                    if (ring) ring->consume_all([&l](handle* h) { l.call(*h); });
+                }
+            }
+
+            bool empty() const noexcept override
+            {
+                return std::ranges::all_of(inbox, [](auto const& ring) { return !ring || ring->empty(); });
+            }
+        };
+
+    public:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        explicit sharded_runtime(shard_options options = { })
+        {
+            auto count = std::max<size_t>(options.shards, 1);
+            for (size_t i = 0; i < count; i++) m_shards.push_back(std::make_unique<shard>());
+            for (size_t to = 0; to < count; to++)
+            {
+                auto& s = *m_shards[to];
+                s.inbox.resize(count);
+                for (size_t from = 0; from < count; from++)
+                {
+                    if (from != to) s.inbox[from] = std::make_unique<spsc_queue<handle*>>(options.ring_capacity);
+                }
+                s.loop.add_source(s);  // before the thread starts
+            }
+
+            try
+            {
+#if defined(__linux__)
+                auto cpus = options.cpus.empty() ? allowed_cpus() : options.cpus;
+#endif
+                for (size_t i = 0; i < count; i++)
+                {
+                    m_shards[i]->thread = std::thread([this, i] { shard_loop(i); });
+#if defined(__linux__)
+                    if (options.pin && !cpus.empty()) pin(m_shards[i]->thread, cpus[i % cpus.size()]);
+#endif
+                }
+            }
+            catch (...)
+            {
+                stop();
+                throw;
+            }
+        }
+
+        explicit sharded_runtime(size_t shards) : sharded_runtime(shard_options{ .shards = shards }) { }
+
+        // stops the shards, see `stop`
+        ~sharded_runtime() { stop(); }
+
+        sharded_runtime(sharded_runtime const&) = delete;
+        sharded_runtime(sharded_runtime&&) = delete;
+        sharded_runtime& operator=(sharded_runtime const&) = delete;
+        sharded_runtime& operator=(sharded_runtime&&) = delete;
+
+        size_t size() const noexcept { return m_shards.size(); }
+
+        // the shard the calling thread runs, npos outside this runtime
+        size_t current_shard() const noexcept { return current_runtime == this ? current_index : npos; }
+
+        // the shard's loop, for timers and I/O, only touch it from that shard
+        Loop& loop(size_t shard) noexcept { return m_shards[shard]->loop; }
+
+        // run `h` on `shard`'s thread in a later iteration, handles from one shard to another keep their order while the ring has room
+        void post(size_t shard, handle& h)
+        {
+            auto& target = *m_shards[shard];
+            auto from = current_shard();
+            if (from == shard)
+                target.loop.call(h);
+            else if (from != npos && target.inbox[from]->push(&h))
+                target.loop.wakeup_if_parked();
+            else
+                target.loop.call_threadsafe(h);  // not a shard, or the ring is full
+        }
+
+        /**
+         * Awaitable of `submit_to`. The task runs on the target shard, the result travels back to the awaiting
+         * shard through the reverse ring, the awaiting coroutine resumes where it was suspended.
+         * Awaited from a thread outside the runtime, it resumes on the target shard instead.
+         */
+        template<typename Ret>
+        class submit_awaiter final : detail::completion_hook
+        {
+        public:
+            submit_awaiter(sharded_runtime& runtime, size_t shard, task<Ret> t) noexcept
+                : m_runtime(runtime), m_target(shard), m_task(std::move(t)) { }
+
+            submit_awaiter(submit_awaiter&& other) noexcept
+                : m_runtime(other.m_runtime), m_target(other.m_target), m_task(std::move(other.m_task)) { }
+            submit_awaiter& operator=(submit_awaiter&&) = delete;
+
+            bool await_ready() const noexcept { return m_task.is_done(); }
+
+            template<typename Promise>
+            void await_suspend(std::coroutine_handle<Promise> awaiting)
+            {
+                m_origin = m_runtime.current_shard();
+                m_awaiting = awaiting;
+                m_resume.set_coroutine(awaiting);  // back home in the awaiting task's class
+                auto& child = m_task.promise();
+                child.set_continuation(std::coroutine_handle<>{ awaiting });  // type erased on purpose, backtraces only, no token
+                child.set_completion_hook(this);
+                m_runtime.post(m_target, child);
+            }
+
+            auto await_resume()
+            {
+                if constexpr (std::is_void_v<Ret>) m_task.promise().result();
+                else return std::move(m_task.promise()).result();
+            }
+
+        private:
+            // on the target shard
+            std::coroutine_handle<> on_complete(detail::promise_base&) noexcept override
+            {
+                if (m_origin == npos || m_origin == m_target) return m_awaiting;
+                m_runtime.post(m_origin, m_resume);  // the awaiter may be gone right after
+                return std::noop_coroutine();
+            }
+
+            sharded_runtime& m_runtime;
+            size_t m_target;
+            size_t m_origin{ npos };
+            task<Ret> m_task;
+            std::coroutine_handle<> m_awaiting{ nullptr };
+            resume_handle m_resume;
+        };
+
+        // `co_await rt.submit_to(shard, t)` runs `t` on `shard` and returns its result or rethrows its exception
+        template<typename Ret>
+        submit_awaiter<Ret> submit_to(size_t shard, task<Ret> t) { return { *this, shard, std::move(t) }; }
+
+        // fire and forget, `shard`'s loop owns the task and destroys it once done, see `Loop::spawn`
+        template<typename Ret>
+        void spawn_on(size_t shard, task<Ret>&& t)
+        {
+            if (auto* h = m_shards[shard]->loop.detach(std::move(t))) post(shard, *h);
+        }
+
+        /**
+         * Stops every shard after its current iteration and joins the threads, from a thread outside the runtime.
+         * Work still suspended on a shard is abandoned, await it first. Loops are kept until destruction.
+         */
+        void stop()
+        {
+            for (auto& s : m_shards)
+            {
+                if (s->thread.joinable()) s->loop.stop();
+            }
+            for (auto& s : m_shards)
+            {
+                if (s->thread.joinable()) s->thread.join();
+            }
+        }
+
+    private:
+        void shard_loop(size_t index)
+        {
+            current_runtime = this;
+            current_index = index;
+            m_shards[index]->loop.run_until_stopped();
+            current_runtime = nullptr;
+        }
+
+#if defined(__linux__)
+        static std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (::sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+            }
+            return cpus;
+        }
+
+        static void pin(std::thread& t, int cpu)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (int rc = ::pthread_setaffinity_np(t.native_handle(), sizeof(set), &set); rc != 0)
+                throw std::system_error(rc, std::system_category(), "pthread_setaffinity_np");
+        }
+#endif
+
+        std::vector<std::unique_ptr<shard>> m_shards;
+
+        inline static thread_local sharded_runtime* current_runtime = nullptr;
+        inline static thread_local size_t current_index = 0;
+    };
+}
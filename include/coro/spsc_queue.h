@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace coro
+{
+    /**
+     * Bounded lock-free single-producer single-consumer ring.
+     * Each side owns one index on its own cache line and keeps a stale copy of the other side's index,
+     * so it only reads the shared one when the ring looks full (producer) or empty (consumer).
+     */
+    template<typename T>
+    class spsc_queue
+    {
+        static constexpr size_t cache_line = 64;
+
+    public:
+        // the capacity is rounded up to a power of two
+        explicit spsc_queue(size_t capacity)
+            : m_capacity(std::bit_ceil(std::max<size_t>(capacity, 2))), m_mask(m_capacity - 1),
+              m_items(std::make_unique<T[]>(m_capacity)) { }
+
+        spsc_queue(spsc_queue const&) = delete;
+        spsc_queue& operator=(spsc_queue const&) = delete;
+
+        // producer only, false if the ring is full
+        bool push(T value) noexcept
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cached_head == m_capacity)
+            {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+                if (tail - m_cached_head == m_capacity) return false;
+            }
+            m_items[tail & m_mask] = std::move(value);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only, pass everything pushed so far to `f(T)` in order, returns the batch size
+        template<typename F>
+        size_t consume_all(F&& f)
+        {
+            auto head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cached_tail)
+            {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cached_tail) return 0;
+            }
+            auto end = m_cached_tail;
+            for (auto i = head; i != end; i++) f(std::move(m_items[i & m_mask]));
+            m_head.store(end, std::memory_order_release);  // the slots may be reused from here on
+            return end - head;
+        }
+
+        // consumer only, also right after a seq_cst fence that pairs with the producer's
+        bool empty() const noexcept
+        {
+            return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const noexcept { return m_capacity; }
+
+    private:
+        size_t const m_capacity;
+        size_t const m_mask;
+        std::unique_ptr<T[]> m_items;
+
+        alignas(cache_line) std::atomic<size_t> m_tail{ 0 };  // written by the producer
+        size_t m_cached_head{ 0 };
+
+        alignas(cache_line) std::atomic<size_t> m_head{ 0 };  // written by the consumer
+        size_t m_cached_tail{ 0 };
+    };
+}
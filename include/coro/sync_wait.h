@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "task.h"
+#include "concepts/awaitable.h"
+
+namespace coro
+{
+    namespace detail
+    {
+        /**
+         * One-shot flag a blocked thread sleeps on, a futex on Linux and `std::atomic::wait` elsewhere.
+         * Waking only touches the flag's address, so the waiter may return and reuse the memory as soon as it sees the flag.
+         */
+        class sync_wait_flag
+        {
+        public:
+            void set() noexcept
+            {
+                m_state.store(1, std::memory_order_release);
+#if defined(__linux__)
+                ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+                m_state.notify_one();
+#endif
+            }
+
+            void wait() noexcept
+            {
+                while (m_state.load(std::memory_order_acquire) == 0)
+                {
+#if defined(__linux__)
+                    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_state), FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);  // EAGAIN if already set
+#else
+                    m_state.wait(0, std::memory_order_acquire);
+#endif
+                }
+            }
+
+        private:
+            std::atomic<uint32_t> m_state{ 0 };
+            static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free);
+        };
+
+        template<typename T>
+        using sync_wait_result_t = std::conditional_t<std::is_lvalue_reference_v<T>, T, std::remove_cvref_t<T>>;
+
+        /**
+         * The coroutine `sync_wait` blocks on. A task promise, so awaited tasks link it as their continuation,
+         * but it signals the blocked thread instead of resuming anything. The result is yielded in place and
+         * stays alive in the suspended frame until the caller took it.
+         */
+        template<typename T>
+        class sync_wait_task
+        {
+        public:
+            struct promise_type;
+            using handle_type = std::coroutine_handle<promise_type>;
+
+            struct notify_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_resume() const noexcept { }
+
+                void await_suspend(handle_type coroutine) const noexcept
+                {
+#if CORO_TRACING
+                    set_current_promise(nullptr);
+#endif
+                    coroutine.promise().m_flag->set();  // the frame may be destroyed right away
+                }
+            };
+
+            struct promise_type final : promise_base
+            {
+                sync_wait_task get_return_object() noexcept
+                {
+                    auto h = handle_type::from_promise(*this);
+                    bind_coroutine(h);
+                    return sync_wait_task{ h };
+                }
+
+                notify_awaiter final_suspend() noexcept { return { }; }
+
+                // `U` only defers forming `T&&` until the call, which never happens for `void`
+                template<typename U = T>
+                notify_awaiter yield_value(std::type_identity_t<U>&& result) noexcept
+                {
+                    m_result = std::addressof(result);
+                    return { };
+                }
+
+                void return_void() noexcept { }
+
+                void run() override final { handle_type::from_promise(*this).resume(); }
+
+                template<typename U = T>
+                U&& result()
+                {
+                    if (m_exception_ptr) std::rethrow_exception(m_exception_ptr);
+                    return static_cast<T&&>(*m_result);
+                }
+
+                void rethrow_if_exception()
+                {
+                    if (m_exception_ptr) std::rethrow_exception(m_exception_ptr);
+                }
+
+                sync_wait_flag* m_flag{ nullptr };
+                std::remove_reference_t<T>* m_result{ nullptr };  // in the suspended frame
+            };
+
+            explicit sync_wait_task(handle_type coroutine) noexcept : m_coroutine(coroutine) { }
+            sync_wait_task(sync_wait_task&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, nullptr)) { }
+            sync_wait_task& operator=(sync_wait_task&&) = delete;
+            ~sync_wait_task() { if (m_coroutine) m_coroutine.destroy(); }
+
+            // runs the coroutine on this thread until it first suspends, then sleeps until it yields or finishes
+            void start_and_wait()
+            {
+                sync_wait_flag flag;
+                m_coroutine.promise().m_flag = &flag;
+                m_coroutine.resume();
+                flag.wait();
+            }
+
+            decltype(auto) result()
+            {
+                if constexpr (std::is_void_v<T>) m_coroutine.promise().rethrow_if_exception();
+                else return m_coroutine.promise().result();
+            }
+
+        private:
+            handle_type m_coroutine;
+        };
+
+        template<typename A, typename T = concepts::AwaitResult<A>>
+        sync_wait_task<T> make_sync_wait_task(A&& awaitable)
+        {
+            if constexpr (std::is_void_v<T>)
+                co_await std::forward<A>(awaitable);
+            else
+                co_yield co_await std::forward<A>(awaitable);
+        }
+    }
+
+    /**
+     * Blocks the calling thread until `awaitable` completes and returns its result, or rethrows its exception.
+     * The awaitable starts on the calling thread and may finish on any other one (a thread_pool, a Loop run by
+     * another thread), the caller sleeps on a futex meanwhile. Never call it from a thread the awaitable needs
+     * to make progress, e.g. the thread running the Loop it waits on.
+     */
+    template<concepts::Awaitable A>
+    auto sync_wait(A&& awaitable) -> detail::sync_wait_result_t<concepts::AwaitResult<A>>
+    {
+        auto t = detail::make_sync_wait_task(std::forward<A>(awaitable));
+        t.start_and_wait();
+        if constexpr (std::is_void_v<concepts::AwaitResult<A>>)
+            t.result();
+        else
+            return t.result();
+    }
+}
@@ -1,13 +1,27 @@
 #pragma once
 
+#include <atomic>
 #include <coroutine>
 #include <exception>
 #include <utility>
+#include <type_traits>
 #include <source_location>
 
 #include <fmt/core.h>
 
 #include "handle.h"
+#include "frame_allocator.h"
+#include "cancellation.h"
+
+// async backtraces: every co_await inside a task records its source location for `dump_callstack`
+// define CORO_TRACING=0 (the default with NDEBUG) for zero-overhead awaits, backtraces then only show frame addresses
+#ifndef CORO_TRACING
+#ifdef NDEBUG
+#define CORO_TRACING 0
+#else
+#define CORO_TRACING 1
+#endif
+#endif
 
 namespace coro
 {
@@ -16,7 +30,66 @@ namespace coro
 
     namespace detail
     {
-        struct promise_base : handle
+        struct promise_base;
+
+#if CORO_TRACING
+        // the task running on this thread, for samplers (see profiler.h), read from a signal handler on this thread
+        inline thread_local std::atomic<promise_base*> current_promise{ nullptr };
+
+        // the fences keep the compiler from sinking or dropping the store around the code the sampler interrupts
+        inline void set_current_promise(promise_base* promise) noexcept
+        {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            current_promise.store(promise, std::memory_order_relaxed);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+
+        template<typename A>
+        decltype(auto) get_awaiter(A&& awaitable)
+        {
+            if constexpr (requires { std::forward<A>(awaitable).operator co_await(); })
+                return std::forward<A>(awaitable).operator co_await();
+            else if constexpr (requires { operator co_await(std::forward<A>(awaitable)); })
+                return operator co_await(std::forward<A>(awaitable));
+            else
+                return std::forward<A>(awaitable);
+        }
+
+        // keeps `current_promise` up to date across a suspension
+        template<typename Awaiter>
+        struct traced_awaiter
+        {
+            Awaiter m_awaiter;  // a reference if the awaitable was its own awaiter
+            promise_base* m_promise;
+
+            bool await_ready() { return m_awaiter.await_ready(); }
+
+            template<typename Promise>
+            decltype(auto) await_suspend(std::coroutine_handle<Promise> coroutine)
+            {
+                set_current_promise(nullptr);
+                return m_awaiter.await_suspend(coroutine);
+            }
+
+            decltype(auto) await_resume()
+            {
+                set_current_promise(m_promise);
+                return m_awaiter.await_resume();
+            }
+        };
+#endif
+
+        // notified instead of resuming the continuation when a task completes, used by the combinators
+        struct completion_hook
+        {
+            // returns the coroutine to transfer to, the hook may destroy `child`
+            virtual std::coroutine_handle<> on_complete(promise_base& child) noexcept = 0;
+
+        protected:
+            ~completion_hook() = default;
+        };
+
+        struct promise_base : handle, frame_allocation  // pooled frames, `std::allocator_arg` aware
         {
             struct final_awaiter
             {
@@ -26,7 +99,17 @@ namespace coro
                 template<typename promise_type>
                 std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> coroutine) noexcept
                 {
+                    if (auto* hook = coroutine.promise().m_hook)
+                    {
+#if CORO_TRACING
+                        set_current_promise(nullptr);
+#endif
+                        return hook->on_complete(coroutine.promise());
+                    }
                     auto continuation = coroutine.promise().m_continuation;
+#if CORO_TRACING
+                    set_current_promise(continuation != nullptr ? &std::coroutine_handle<promise_base>::from_address(continuation.address()).promise() : nullptr);
+#endif
                     if (continuation != nullptr)
                         return continuation;
                     else
@@ -34,24 +117,91 @@ namespace coro
                 }
             };
 
+#if CORO_TRACING
+            struct initial_awaiter : std::suspend_always
+            {
+                promise_base* m_promise;
+                void await_resume() const noexcept { set_current_promise(m_promise); }
+            };
+
+            // names the frame before its first co_await
+            initial_awaiter initial_suspend(std::source_location loc = std::source_location::current())
+            {
+                m_frame_info = loc;
+                return { { }, this };
+            }
+#else
             std::suspend_always initial_suspend() { return { }; }
+#endif
             final_awaiter final_suspend() noexcept { return { }; }
             void unhandled_exception() { m_exception_ptr = std::current_exception(); }
 
-            void set_continuation(std::coroutine_handle<> continuation) noexcept { m_continuation = continuation; }
+            // a task without a cancellation token, class or deadline of its own inherits those of the task awaiting it
+            template<typename Promise>
+            void set_continuation(std::coroutine_handle<Promise> continuation) noexcept
+            {
+                m_continuation = continuation;
+                inherit_cancellation_token(continuation);
+                inherit_schedule(continuation);
+            }
 
+            // the token only, for children that may outlive `parent` (e.g. when_any losers), a backtrace link would dangle
+            template<typename Promise>
+            void inherit_cancellation_token(std::coroutine_handle<Promise> parent) noexcept
+            {
+                if constexpr (std::is_base_of_v<promise_base, Promise>)
+                {
+                    if (!m_token.can_be_cancelled()) m_token = static_cast<promise_base&>(parent.promise()).m_token;
+                }
+            }
+
+            // a task still at `priority::normal` without a deadline runs like `parent`, see `Loop::call`
+            template<typename Promise>
+            void inherit_schedule(std::coroutine_handle<Promise> parent) noexcept
+            {
+                if constexpr (std::is_base_of_v<promise_base, Promise>)
+                {
+                    if (get_priority() == priority::normal && get_deadline() == no_deadline) copy_schedule(parent.promise());
+                }
+            }
+
+            // set on the root of a task tree before starting it
+            void set_cancellation_token(cancellation_token token) noexcept { m_token = std::move(token); }
+            cancellation_token const& get_cancellation_token() const noexcept { return m_token; }
+
+            // takes precedence over the continuation, which then only links backtraces
+            void set_completion_hook(completion_hook* hook) noexcept { m_hook = hook; }
+
+            // the frame this promise lives in
+            std::coroutine_handle<> coroutine() const noexcept { return bound_coroutine(); }
+
+#if CORO_TRACING
             // FIXME: awaitable concept?
             template<typename A>
-            decltype(auto) await_transform(A&& awaiter, // for collecting source_location info
-                                           std::source_location loc = std::source_location::current()) {
+            auto await_transform(A&& awaiter, // for collecting source_location info
+                                 std::source_location loc = std::source_location::current()) {
                 m_frame_info = loc;
-                return std::forward<A>(awaiter);
+                using awaiter_type = decltype(get_awaiter(std::forward<A>(awaiter)));
+                return traced_awaiter<awaiter_type>{ get_awaiter(std::forward<A>(awaiter)), this };
             }
 
             std::source_location const& get_frame_info() const { return m_frame_info; }
+
+            // the task awaiting this one, if any
+            promise_base const* caller() const noexcept
+            {
+                if (m_continuation == nullptr) return nullptr;
+                return &std::coroutine_handle<promise_base>::from_address(m_continuation.address()).promise();
+            }
+#endif
+
             void dump_backtrace(size_t depth = 0) const override final
             {
+#if CORO_TRACING
                 auto frame_name = fmt::format("{} at {}:{}", m_frame_info.function_name(), m_frame_info.file_name(), m_frame_info.line());
+#else
+                auto frame_name = fmt::format("<frame {}>", static_cast<void const*>(this));
+#endif
                 fmt::print("[{}] {}\n", depth, frame_name);
                 if (auto p = std::coroutine_handle<promise_base>::from_address(m_continuation.address())) { p.promise().dump_backtrace(depth + 1); }
                 else fmt::print("\n"); 
@@ -59,8 +209,12 @@ namespace coro
 
         protected:
             std::coroutine_handle<> m_continuation{ nullptr };
+            completion_hook* m_hook{ nullptr };
             std::exception_ptr m_exception_ptr{ };
+            cancellation_token m_token;
+#if CORO_TRACING
             std::source_location m_frame_info;
+#endif
         };
 
         template<typename Ret>
@@ -153,6 +307,9 @@ namespace coro
             return !m_coroutine.done();
         }
 
+        // gives up ownership of the frame
+        handle_type release() noexcept { return std::exchange(m_coroutine, nullptr); }
+
         bool destroy()
         {
             if (m_coroutine == nullptr) return false;
@@ -167,7 +324,8 @@ namespace coro
 
             awaiter_base(handle_type coroutine) noexcept : m_coroutine(coroutine) { }
             bool await_ready() const noexcept { return !m_coroutine || m_coroutine.done(); }
-            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting_coroutine) noexcept
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting_coroutine) noexcept
             {
                 m_coroutine.promise().set_continuation(awaiting_coroutine);
                 return m_coroutine;
@@ -218,10 +376,21 @@ namespace coro
 
     namespace detail
     {
+        // binding the coroutine lets a Loop resume the task without going through `run`
         template<typename Ret>
-        inline task<Ret> promise<Ret>::get_return_object() noexcept { return task<Ret>(handle_type::from_promise(*this)); }
+        inline task<Ret> promise<Ret>::get_return_object() noexcept
+        {
+            auto h = handle_type::from_promise(*this);
+            bind_coroutine(h);
+            return task<Ret>(h);
+        }
 
-        inline task<> promise<void>::get_return_object() noexcept { return task<>(handle_type::from_promise(*this)); }
+        inline task<> promise<void>::get_return_object() noexcept
+        {
+            auto h = handle_type::from_promise(*this);
+            bind_coroutine(h);
+            return task<>(h);
+        }
 
         template<typename Ret>
         inline void promise<Ret>::run() { auto h = handle_type::from_promise(*this); if (h != nullptr && !h.done()) h.resume(); }
@@ -240,7 +409,25 @@ namespace coro
                 return false;
             }
         };
+
+        struct CancellationTokenAwaiter
+        {
+            cancellation_token m_token;
+
+            bool await_ready() const noexcept { return false; }
+            cancellation_token await_resume() noexcept { return std::move(m_token); }
+
+            template<typename Promise>
+            bool await_suspend(std::coroutine_handle<Promise> caller) noexcept
+            {
+                m_token = caller.promise().get_cancellation_token();
+                return false;
+            }
+        };
     }
 
+    // `cancellation_token token = co_await current_cancellation_token();` the token the current task runs with
+    inline auto current_cancellation_token() -> detail::CancellationTokenAwaiter { return {}; }
+
     auto dump_callstack() -> detail::CallStackAwaiter { return {}; }
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "task.h"
+#include "event.h"
+#include "cancellation.h"
+
+namespace coro
+{
+    namespace detail
+    {
+        class task_group_state;
+
+        // a spawned child, linked into its group until it completes
+        struct task_group_node : completion_hook
+        {
+            task_group_state* m_group{ nullptr };
+            task_group_node* m_prev{ nullptr };
+            task_group_node* m_next{ nullptr };
+
+            virtual ~task_group_node() = default;
+        };
+
+        /**
+         * What the children of a `task_group` point to. Owned by the group, or by its last child if the group
+         * was destroyed before its children completed.
+         */
+        class task_group_state
+        {
+        public:
+            template<typename Scheduler>
+            task_group_state(Scheduler& scheduler, cancellation_token const& parent)
+                : m_scheduler(&scheduler), m_schedule(&schedule_on<Scheduler>)
+            {
+                if (parent.can_be_cancelled()) m_link.emplace(parent, forward{ &m_source });
+            }
+
+            template<typename Ret>
+            void spawn(task<Ret> t)
+            {
+                struct node final : task_group_node
+                {
+                    task<Ret> m_task;
+
+                    explicit node(task<Ret> child) noexcept : m_task(std::move(child)) { }
+
+                    std::coroutine_handle<> on_complete(promise_base&) noexcept override
+                    {
+                        std::exception_ptr error;
+                        try
+                        {
+                            m_task.promise().result();
+                        }
+                        catch (...)
+                        {
+                            error = std::current_exception();
+                        }
+                        return m_group->complete(*this, std::move(error));  // destroys the node and the child's frame
+                    }
+                };
+
+                if (t.is_done()) return;
+                auto* n = new node(std::move(t));
+                auto& promise = n->m_task.promise();
+                promise.set_cancellation_token(m_source.token());
+                promise.set_completion_hook(n);
+                {
+                    std::lock_guard lock(m_mutex);
+                    link(*n);
+                }
+                m_schedule(m_scheduler, promise, n->m_task.handle());
+            }
+
+            // false if every child completed, the awaiting coroutine then carries on
+            bool suspend(std::coroutine_handle<> joiner) noexcept
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_head == nullptr) return false;
+                m_joiner = joiner;
+                return true;
+            }
+
+            void rethrow_if_failed()
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+            }
+
+            void cancel() noexcept { m_source.request_cancellation(); }
+
+            bool is_idle() const noexcept
+            {
+                std::lock_guard lock(m_mutex);
+                return m_head == nullptr;
+            }
+
+            // the group is destroyed, the children left are cancelled and free the state once they are done
+            void abandon() noexcept
+            {
+                cancel();
+                bool idle;
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_abandoned = true;
+                    idle = m_head == nullptr;
+                }
+                if (idle) delete this;
+            }
+
+        private:
+            struct forward
+            {
+                cancellation_source* m_source;
+                void operator()() const noexcept { m_source->request_cancellation(); }
+            };
+
+            template<typename Scheduler>
+            static void schedule_on(void* scheduler, promise_base& promise, std::coroutine_handle<> coroutine)
+            {
+                auto& s = *static_cast<Scheduler*>(scheduler);
+                if constexpr (handle_scheduler<Scheduler>) s.call(static_cast<handle&>(promise));
+                else s.enqueue(coroutine);
+            }
+
+            std::coroutine_handle<> complete(task_group_node& n, std::exception_ptr error) noexcept
+            {
+                // the first failure cancels the siblings, the child still counts so that nobody resumes the joiner yet
+                bool first = false;
+                if (error)
+                {
+                    std::lock_guard lock(m_mutex);
+                    if (!m_failed)
+                    {
+                        m_failed = first = true;
+                        m_error = std::move(error);
+                    }
+                }
+                if (first) cancel();
+
+                std::coroutine_handle<> next = std::noop_coroutine();
+                bool release = false;
+                {
+                    std::lock_guard lock(m_mutex);
+                    unlink(n);
+                    if (m_head == nullptr)
+                    {
+                        if (m_joiner) next = std::exchange(m_joiner, nullptr);
+                        release = m_abandoned;
+                    }
+                }
+                delete &n;
+                if (release) delete this;
+                return next;
+            }
+
+            void link(task_group_node& n) noexcept
+            {
+                n.m_group = this;
+                n.m_next = m_head;
+                if (m_head != nullptr) m_head->m_prev = &n;
+                m_head = &n;
+            }
+
+            void unlink(task_group_node& n) noexcept
+            {
+                if (n.m_prev != nullptr) n.m_prev->m_next = n.m_next;
+                else m_head = n.m_next;
+                if (n.m_next != nullptr) n.m_next->m_prev = n.m_prev;
+            }
+
+            void* m_scheduler;
+            void (*m_schedule)(void*, promise_base&, std::coroutine_handle<>);
+            cancellation_source m_source;
+            std::optional<cancellation_callback<forward>> m_link;  // to the token the group was created with
+
+            mutable std::mutex m_mutex;  // children may complete on pool threads
+            task_group_node* m_head{ nullptr };  // running children
+            std::coroutine_handle<> m_joiner{ nullptr };
+            std::exception_ptr m_error;
+            bool m_failed{ false };
+            bool m_abandoned{ false };
+        };
+    }
+
+    /**
+     * Owns a dynamic number of child tasks, started on a `Loop` or `thread_pool` in a later iteration.
+     *
+     *     task_group group{ loop, co_await current_cancellation_token() };
+     *     for (auto& r : requests) group.spawn(handle(r));
+     *     co_await group.join();
+     *
+     * Children are linked into an intrusive list and freed as they complete, results are discarded.
+     * The first exception cancels the siblings through the group's cancellation token and is rethrown by `join`.
+     * Cancelling the token the group was created with cancels the children as well.
+     * Destroying a group with running children cancels and detaches them, await `join` to bound their lifetime.
+     */
+    class task_group
+    {
+    public:
+        template<event_scheduler Scheduler>
+        explicit task_group(Scheduler& scheduler, cancellation_token const& parent = { })
+            : m_state(new detail::task_group_state(scheduler, parent)) { }
+
+        ~task_group() { m_state->abandon(); }
+
+        task_group(task_group const&) = delete;
+        task_group& operator=(task_group const&) = delete;
+
+        // the child runs on the scheduler, on a Loop call this from the loop thread
+        template<typename Ret>
+        void spawn(task<Ret> t) { m_state->spawn(std::move(t)); }
+
+        void cancel() noexcept { m_state->cancel(); }
+
+        bool is_idle() const noexcept { return m_state->is_idle(); }
+
+        class join_awaiter
+        {
+        public:
+            explicit join_awaiter(detail::task_group_state& state) noexcept : m_state(state) { }
+
+            bool await_ready() const noexcept { return m_state.is_idle(); }
+            bool await_suspend(std::coroutine_handle<> joiner) noexcept { return m_state.suspend(joiner); }
+            void await_resume() { m_state.rethrow_if_failed(); }
+
+        private:
+            detail::task_group_state& m_state;
+        };
+
+        // `co_await group.join()` resumes once every child completed, children spawned meanwhile included
+        join_awaiter join() noexcept { return join_awaiter{ *m_state }; }
+
+    private:
+        detail::task_group_state* m_state;
+    };
+}
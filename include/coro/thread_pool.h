@@ -0,0 +1,270 @@
+#pragma once
+
+#include <coroutine>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+#include "task.h"
+
+namespace coro
+{
+    namespace detail
+    {
+        /**
+         * Chase-Lev work stealing deque, memory orders as in Le et al. "Correct and Efficient Work-Stealing for Weak Memory Models".
+         * The owner thread pushes and pops at the bottom, other threads steal from the top.
+         * Items must be trivially copyable, retired rings are kept until destruction since thieves may still read them.
+         */
+        template<typename T>
+        class work_stealing_deque
+        {
+            struct ring
+            {
+                explicit ring(int64_t cap) : capacity(cap), mask(cap - 1), items(new std::atomic<T>[static_cast<size_t>(cap)]) { }
+
+                void put(int64_t i, T x) noexcept { items[static_cast<size_t>(i & mask)].store(x, std::memory_order_relaxed); }
+                T get(int64_t i) const noexcept { return items[static_cast<size_t>(i & mask)].load(std::memory_order_relaxed); }
+
+                ring* grow(int64_t bottom, int64_t top) const
+                {
+                    auto* r = new ring(capacity * 2);
+                    for (auto i = top; i != bottom; i++) r->put(i, get(i));
+                    return r;
+                }
+
+                int64_t capacity;
+                int64_t mask;
+                std::unique_ptr<std::atomic<T>[]> items;
+            };
+
+        public:
+            explicit work_stealing_deque(int64_t capacity = 256) : m_ring(new ring(capacity)) { m_rings.emplace_back(m_ring.load(std::memory_order_relaxed)); }
+            work_stealing_deque(work_stealing_deque const&) = delete;
+            work_stealing_deque& operator=(work_stealing_deque const&) = delete;
+
+            // owner only
+            void push(T x)
+            {
+                auto b = m_bottom.load(std::memory_order_relaxed);
+                auto t = m_top.load(std::memory_order_acquire);
+                auto* r = m_ring.load(std::memory_order_relaxed);
+                if (b - t > r->capacity - 1)
+                {
+                    r = r->grow(b, t);
+                    m_rings.emplace_back(r);
+                    m_ring.store(r, std::memory_order_release);
+                }
+                r->put(b, x);
+                std::atomic_thread_fence(std::memory_order_release);
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            // owner only
+            std::optional<T> pop()
+            {
+                auto b = m_bottom.load(std::memory_order_relaxed) - 1;
+                auto* r = m_ring.load(std::memory_order_relaxed);
+                m_bottom.store(b, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto t = m_top.load(std::memory_order_relaxed);
+
+                if (t > b)  // empty
+                {
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                    return std::nullopt;
+                }
+                auto x = r->get(b);
+                if (t == b)  // last item, race against thieves
+                {
+                    bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                    if (!won) return std::nullopt;
+                }
+                return x;
+            }
+
+            // any thread
+            std::optional<T> steal()
+            {
+                auto t = m_top.load(std::memory_order_acquire);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                auto b = m_bottom.load(std::memory_order_acquire);
+                if (t >= b) return std::nullopt;
+
+                auto* r = m_ring.load(std::memory_order_acquire);
+                auto x = r->get(t);
+                if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return std::nullopt;  // lost the race
+                return x;
+            }
+
+            bool empty() const noexcept
+            {
+                return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+            }
+
+        private:
+            alignas(64) std::atomic<int64_t> m_top{ 0 };
+            alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+            alignas(64) std::atomic<ring*> m_ring;
+            std::vector<std::unique_ptr<ring>> m_rings;  // current and retired rings, owner only
+        };
+    }
+
+    /**
+     * Multi-threaded executor, each worker owns a Chase-Lev deque and steals from the others when it runs dry.
+     * Work items are suspended coroutines, submitted with `co_await pool.schedule()` or `pool.call(task)`.
+     * Submissions from outside the pool go through a shared injection queue.
+     */
+    class thread_pool
+    {
+        struct worker
+        {
+            detail::work_stealing_deque<void*> deque;
+            uint64_t rng{ 0 };  // victim selection
+        };
+
+    public:
+        explicit thread_pool(size_t thread_count = std::thread::hardware_concurrency())
+        {
+            if (thread_count == 0) thread_count = 1;
+            for (size_t i = 0; i < thread_count; i++)
+            {
+                m_workers.push_back(std::make_unique<worker>());
+                m_workers.back()->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+            }
+            for (size_t i = 0; i < thread_count; i++)
+                m_threads.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        // remaining work is drained before the workers exit
+        ~thread_pool()
+        {
+            m_stop.store(true, std::memory_order_seq_cst);
+            m_epoch.fetch_add(1, std::memory_order_seq_cst);
+            m_epoch.notify_all();
+            for (auto& t : m_threads) t.join();
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool(thread_pool&&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool&&) = delete;
+
+        class schedule_awaiter
+        {
+        public:
+            explicit schedule_awaiter(thread_pool& pool) noexcept : m_pool(pool) { }
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> coroutine) { m_pool.enqueue(coroutine); }
+            void await_resume() const noexcept { }
+
+        private:
+            thread_pool& m_pool;
+        };
+
+        // resume the awaiting coroutine on one of the pool threads
+        schedule_awaiter schedule() noexcept { return schedule_awaiter{ *this }; }
+
+        // start a not yet started task on the pool, `_task` must outlive its execution
+        template<typename Ret>
+        void call(task<Ret>& _task)
+        {
+            enqueue(_task.handle());
+        }
+
+        void enqueue(std::coroutine_handle<> coroutine)
+        {
+            if (current_pool == this)
+                m_workers[current_index]->deque.push(coroutine.address());
+            else
+            {
+                std::lock_guard lock(m_mutex);
+                m_injected.push_back(coroutine.address());
+            }
+            m_epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+                m_epoch.notify_one();
+        }
+
+        size_t thread_count() const noexcept { return m_threads.size(); }
+
+        // whether the calling thread is one of this pool's workers
+        bool is_worker() const noexcept { return current_pool == this; }
+
+    private:
+        void worker_loop(size_t index)
+        {
+            current_pool = this;
+            current_index = index;
+
+            while (true)
+            {
+                auto epoch = m_epoch.load(std::memory_order_seq_cst);
+                if (auto item = find_work(index))
+                {
+                    std::coroutine_handle<>::from_address(*item).resume();
+                    continue;
+                }
+                if (m_stop.load(std::memory_order_seq_cst)) break;
+
+                m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+                m_epoch.wait(epoch, std::memory_order_seq_cst);
+                m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+            }
+
+            current_pool = nullptr;
+        }
+
+        std::optional<void*> find_work(size_t index)
+        {
+            auto& self = *m_workers[index];
+            if (auto item = self.deque.pop()) return item;
+
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_injected.empty())
+                {
+                    auto* item = m_injected.front();
+                    m_injected.pop_front();
+                    return item;
+                }
+            }
+
+            // xorshift, start stealing from a random victim
+            self.rng ^= self.rng << 13;
+            self.rng ^= self.rng >> 7;
+            self.rng ^= self.rng << 17;
+            auto n = m_workers.size();
+            for (size_t i = 0, start = static_cast<size_t>(self.rng % n); i < n; i++)
+            {
+                auto victim = (start + i) % n;
+                if (victim == index) continue;
+                if (auto item = m_workers[victim]->deque.steal()) return item;
+            }
+            return std::nullopt;
+        }
+
+    private:
+        std::vector<std::unique_ptr<worker>> m_workers;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::deque<void*> m_injected;  // submissions from non-worker threads, guarded by m_mutex
+
+        std::atomic<uint64_t> m_epoch{ 0 };  // bumped on every submission, idle workers wait on it
+        std::atomic<size_t> m_sleeping{ 0 };
+        std::atomic<bool> m_stop{ false };
+
+        inline static thread_local thread_pool* current_pool = nullptr;
+        inline static thread_local size_t current_index = 0;
+    };
+}
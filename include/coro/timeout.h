@@ -0,0 +1,186 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "task.h"
+#include "loop.h"
+#include "cancellation.h"
+
+namespace coro
+{
+    // what `with_timeout` throws when the deadline passed first, `std::errc::timed_out`
+    class operation_timed_out : public std::system_error
+    {
+    public:
+        operation_timed_out() : std::system_error(std::make_error_code(std::errc::timed_out)) { }
+    };
+
+    namespace detail
+    {
+        /**
+         * Shared by the awaitable and the running task, the task and a loop timer race for resuming the awaiting coroutine.
+         * The state is the timer's handle. A task that loses is cancelled through its own token and detached,
+         * the state and the task's frame are freed once it finishes. A task that completes while its timer is already
+         * queued leaves resuming the awaiting coroutine to the timer, which then delivers the result.
+         */
+        template<typename Ret>
+        class timeout_state final : public completion_hook, public handle
+        {
+        public:
+            timeout_state(Loop& loop, task<Ret> t) noexcept : m_loop(loop), m_task(std::move(t)) { }
+
+            std::coroutine_handle<> on_complete(promise_base&) noexcept override
+            {
+                if (m_timed_out)
+                {
+                    release();  // detached, nobody waits for it any more
+                    return std::noop_coroutine();
+                }
+                m_completed = true;
+                m_link.reset();
+                if (!m_loop.cancel(m_timer))
+                {
+                    // fired in the same batch, the queued timer handle still points here and resumes the awaiter
+                    m_resume_on_timer = !m_starting;
+                    release();
+                    return std::noop_coroutine();
+                }
+                m_refs--;  // the cancelled timer's, never the last one, the awaitable holds one
+                release();  // the task's
+                return m_starting ? std::noop_coroutine() : m_awaiting;
+            }
+
+            // the timer fired, first unless the task completed in the meantime
+            void run() override
+            {
+                auto awaiting = m_awaiting;
+                if (m_completed)
+                {
+                    bool resume = m_resume_on_timer;
+                    release();  // may be the last reference if the awaiter resumed synchronously
+                    if (resume) awaiting.resume();
+                    return;
+                }
+                m_timed_out = true;
+                m_link.reset();
+                m_source.request_cancellation();  // may complete the task inline, which only releases it
+                release();  // not the last reference, the awaitable holds one
+                awaiting.resume();
+            }
+
+            // returns false if the task completed synchronously
+            template<typename Promise>
+            bool start(std::coroutine_handle<Promise> awaiting, Loop::clock_type::time_point deadline)
+            {
+                if (m_task.is_done())  // completed before, no race
+                {
+                    m_completed = true;
+                    release();
+                    return false;
+                }
+                m_awaiting = awaiting;
+                auto& child = m_task.promise();
+                child.set_cancellation_token(m_source.token());
+                child.inherit_schedule(awaiting);
+                child.set_completion_hook(this);
+
+                // cancelling the awaiting task cancels the child as well
+                if (auto token = cancellation_token_of(awaiting); token.can_be_cancelled())
+                    m_link.emplace(std::move(token), forward{ &m_source });
+
+                m_refs++;  // the armed timer's, released by `run` or when it is cancelled
+                if constexpr (std::is_base_of_v<handle, Promise>) copy_schedule(awaiting.promise());  // the timer resumes it
+                m_timer = m_loop.call_at(deadline, static_cast<handle&>(*this));
+                m_starting = true;
+                m_task.handle().resume();
+                m_starting = false;
+                return !m_completed;
+            }
+
+            auto result()
+            {
+                if (m_timed_out) throw operation_timed_out{ };
+                if constexpr (std::is_void_v<Ret>) m_task.promise().result();
+                else return std::move(m_task.promise()).result();
+            }
+
+            void release() noexcept
+            {
+                if (--m_refs == 0) delete this;
+            }
+
+        private:
+            struct forward
+            {
+                cancellation_source* m_source;
+                void operator()() const noexcept { m_source->request_cancellation(); }
+            };
+
+            Loop& m_loop;
+            task<Ret> m_task;
+            cancellation_source m_source;
+            std::optional<cancellation_callback<forward>> m_link;
+            std::coroutine_handle<> m_awaiting{ nullptr };
+            timer_id m_timer;
+            int m_refs{ 2 };  // the awaitable and the running task, plus the timer once armed, all on the loop thread
+            bool m_starting{ false };
+            bool m_completed{ false };
+            bool m_resume_on_timer{ false };
+            bool m_timed_out{ false };
+        };
+    }
+
+    /**
+     * Awaitable of `with_timeout`, resumes with the task's result, or throws `operation_timed_out` once the timeout
+     * passed first. The late task is cancelled through its cancellation token and keeps running detached until it
+     * notices, timers and I/O waits it is suspended in complete right away. Await it on the loop thread.
+     */
+    template<typename Ret>
+    class with_timeout_awaitable
+    {
+        using state_type = detail::timeout_state<Ret>;
+
+    public:
+        with_timeout_awaitable(Loop& loop, task<Ret> t, Loop::clock_type::time_point deadline)
+            : m_state(new state_type(loop, std::move(t))), m_deadline(deadline) { }
+
+        ~with_timeout_awaitable()
+        {
+            if (m_state == nullptr) return;
+            if (m_started) m_state->release();
+            else delete m_state;
+        }
+
+        with_timeout_awaitable(with_timeout_awaitable&& other) noexcept
+            : m_state(std::exchange(other.m_state, nullptr)), m_deadline(other.m_deadline), m_started(other.m_started) { }
+        with_timeout_awaitable& operator=(with_timeout_awaitable&&) = delete;
+
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> awaiting)
+        {
+            m_started = true;
+            return m_state->start(awaiting, m_deadline);
+        }
+
+        auto await_resume() { return m_state->result(); }
+
+    private:
+        state_type* m_state{ nullptr };
+        Loop::clock_type::time_point m_deadline;
+        bool m_started{ false };
+    };
+
+    // `co_await with_timeout(loop, fetch(), 10ms)`, the timeout starts when the awaitable is created
+    template<typename Ret, typename Rep, typename Period>
+    with_timeout_awaitable<Ret> with_timeout(Loop& loop, task<Ret> t, std::chrono::duration<Rep, Period> timeout)
+    {
+        return { loop, std::move(t), Loop::clock_type::now() + std::chrono::ceil<Loop::clock_type::duration>(timeout) };
+    }
+}
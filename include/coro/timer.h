@@ -0,0 +1,319 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <bit>
+#include <type_traits>
+
+namespace coro
+{
+    // returned by timer queues on insertion, used for cancellation (stale ids are ignored)
+    struct timer_id
+    {
+        uint32_t index{ std::numeric_limits<uint32_t>::max() };
+        uint32_t generation{ 0 };
+    };
+
+    namespace detail
+    {
+        inline constexpr uint32_t timer_npos = std::numeric_limits<uint32_t>::max();
+
+        template<typename T>
+        struct timer_node
+        {
+            T value{ };
+            uint64_t deadline{ 0 };  // in ticks (microseconds)
+            uint32_t prev{ timer_npos };
+            uint32_t next{ timer_npos };  // also links the free list
+            uint32_t generation{ 0 };
+            uint32_t list{ timer_npos };  // owning list, timer_npos if free
+        };
+
+        // index based node storage, so that growing does not invalidate links and ids can be validated
+        template<typename T>
+        class timer_pool
+        {
+        public:
+            uint32_t acquire(uint64_t deadline, T&& value)
+            {
+                uint32_t index = m_free;
+                if (index != timer_npos)
+                    m_free = m_nodes[index].next;
+                else
+                {
+                    index = static_cast<uint32_t>(m_nodes.size());
+                    m_nodes.emplace_back();
+                }
+                auto& n = m_nodes[index];
+                n.value = std::move(value);
+                n.deadline = deadline;
+                n.prev = n.next = timer_npos;
+                return index;
+            }
+
+            T release(uint32_t index)
+            {
+                auto& n = m_nodes[index];
+                T value = std::move(n.value);
+                n.generation++;  // invalidate outstanding timer_id
+                n.list = timer_npos;
+                n.next = m_free;
+                m_free = index;
+                return value;
+            }
+
+            bool is_live(timer_id id) const noexcept
+            {
+                return id.index < m_nodes.size() && m_nodes[id.index].generation == id.generation && m_nodes[id.index].list != timer_npos;
+            }
+
+            timer_node<T>& operator[](uint32_t index) noexcept { return m_nodes[index]; }
+            timer_node<T> const& operator[](uint32_t index) const noexcept { return m_nodes[index]; }
+
+        private:
+            std::vector<timer_node<T>> m_nodes;
+            uint32_t m_free{ timer_npos };
+        };
+    }
+
+    /**
+     * Hierarchical timing wheel with microsecond ticks.
+     *
+     * 6 levels of 64 slots each cover 2^36 us (~19 hours), later timers are parked in an overflow list.
+     * A timer lives in the level of the highest 6-bit digit in which its deadline differs from the current tick,
+     * so all timers of a level share the upper digits with the current tick and slots can be found with a bitmap scan.
+     * Insert and cancel are O(1), expiring a slot cascades its timers down one or more levels.
+     */
+    template<typename T>
+    class timing_wheel
+    {
+        using US = std::chrono::microseconds;
+
+        static constexpr uint32_t slot_bits = 6;
+        static constexpr uint32_t slots = 1u << slot_bits;
+        static constexpr uint32_t slot_mask = slots - 1;
+        static constexpr uint32_t levels = 6;
+        static constexpr uint32_t overflow = levels * slots;  // list index of timers beyond the top level
+
+    public:
+        timing_wheel() { std::ranges::fill(m_heads, detail::timer_npos); }
+
+        timer_id add(US deadline, T value)
+        {
+            auto ticks = static_cast<uint64_t>(std::max<US::rep>(deadline.count(), 0));
+            auto index = m_pool.acquire(ticks, std::move(value));
+            link(index, list_of(ticks));
+            m_size++;
+            return { index, m_pool[index].generation };
+        }
+
+        bool cancel(timer_id id)
+        {
+            if (!m_pool.is_live(id)) return false;
+            unlink(id.index);
+            m_pool.release(id.index);
+            m_size--;
+            return true;
+        }
+
+        // the value of a pending timer, nullptr if it fired or was cancelled
+        T const* find(timer_id id) const noexcept { return m_pool.is_live(id) ? &m_pool[id.index].value : nullptr; }
+
+        // invoke `f(T&&)`, or `f(T&&, deadline)`, on every timer due at `now`, returns the number of expired timers
+        template<typename F>
+        size_t expire(US now, F&& f)
+        {
+            auto const until = static_cast<uint64_t>(std::max<US::rep>(now.count(), 0));
+            size_t fired = 0;
+            while (auto e = next_expiration())
+            {
+                auto [list, time] = *e;
+                if (time > until) break;
+                m_current = std::max(m_current, time);
+
+                // detach the whole slot, then fire due timers and cascade the others to lower levels
+                auto index = take(list);
+                while (index != detail::timer_npos)
+                {
+                    auto next = m_pool[index].next;
+                    auto deadline = m_pool[index].deadline;
+                    if (deadline <= m_current)
+                    {
+                        m_size--;
+                        if constexpr (std::is_invocable_v<F&, T&&, US>) f(m_pool.release(index), US(static_cast<US::rep>(deadline)));
+                        else f(m_pool.release(index));
+                        fired++;
+                    }
+                    else
+                        link(index, list_of(deadline));
+                    index = next;
+                }
+            }
+            m_current = std::max(m_current, until);
+            return fired;
+        }
+
+        // lower bound of the earliest deadline, exact for timers in the lowest level
+        std::optional<US> next_deadline() const
+        {
+            if (auto e = next_expiration()) return US(static_cast<US::rep>(e->second));
+            return std::nullopt;
+        }
+
+        bool empty() const noexcept { return m_size == 0; }
+        size_t size() const noexcept { return m_size; }
+
+    private:
+        uint32_t list_of(uint64_t deadline) const noexcept
+        {
+            if (deadline <= m_current)  // already due, expire with the current tick
+                return static_cast<uint32_t>(m_current & slot_mask);
+            auto level = static_cast<uint32_t>(std::bit_width(deadline ^ m_current) - 1) / slot_bits;
+            if (level >= levels) return overflow;
+            return level * slots + static_cast<uint32_t>((deadline >> (level * slot_bits)) & slot_mask);
+        }
+
+        // {list, time} of the first non-empty slot, time is the start of that slot
+        std::optional<std::pair<uint32_t, uint64_t>> next_expiration() const noexcept
+        {
+            for (uint32_t level = 0; level < levels; level++)
+            {
+                auto shift = level * slot_bits;
+                auto digit = (m_current >> shift) & slot_mask;
+                auto occupied = m_occupied[level] & (~uint64_t{ 0 } << digit);
+                if (occupied == 0) continue;
+
+                auto slot = static_cast<uint64_t>(std::countr_zero(occupied));
+                auto base = m_current & ~((uint64_t{ 1 } << (shift + slot_bits)) - 1);
+                return std::pair{ level * slots + static_cast<uint32_t>(slot), base | (slot << shift) };
+            }
+            if (m_heads[overflow] != detail::timer_npos)
+            {
+                constexpr auto span = levels * slot_bits;
+                return std::pair{ overflow, ((m_current >> span) + 1) << span };
+            }
+            return std::nullopt;
+        }
+
+        void link(uint32_t index, uint32_t list) noexcept
+        {
+            auto& n = m_pool[index];
+            n.list = list;
+            n.prev = detail::timer_npos;
+            n.next = m_heads[list];
+            if (n.next != detail::timer_npos) m_pool[n.next].prev = index;
+            m_heads[list] = index;
+            if (list != overflow) m_occupied[list / slots] |= uint64_t{ 1 } << (list & slot_mask);
+        }
+
+        void unlink(uint32_t index) noexcept
+        {
+            auto& n = m_pool[index];
+            if (n.prev != detail::timer_npos) m_pool[n.prev].next = n.next;
+            else m_heads[n.list] = n.next;
+            if (n.next != detail::timer_npos) m_pool[n.next].prev = n.prev;
+            if (n.list != overflow && m_heads[n.list] == detail::timer_npos)
+                m_occupied[n.list / slots] &= ~(uint64_t{ 1 } << (n.list & slot_mask));
+        }
+
+        uint32_t take(uint32_t list) noexcept
+        {
+            auto head = std::exchange(m_heads[list], detail::timer_npos);
+            if (list != overflow) m_occupied[list / slots] &= ~(uint64_t{ 1 } << (list & slot_mask));
+            return head;
+        }
+
+    private:
+        detail::timer_pool<T> m_pool;
+        uint32_t m_heads[levels * slots + 1] = { };
+        uint64_t m_occupied[levels] = { };  // non-empty slot bitmap per level
+        uint64_t m_current{ 0 };  // current tick
+        size_t m_size{ 0 };
+    };
+
+    /**
+     * Binary min heap of deadlines, O(log n) insert.
+     * Cancellation only invalidates the node, stale heap entries are dropped lazily when they reach the top.
+     */
+    template<typename T>
+    class timer_heap
+    {
+        using US = std::chrono::microseconds;
+
+        struct entry
+        {
+            US deadline;
+            timer_id id;
+        };
+
+    public:
+        timer_id add(US deadline, T value)
+        {
+            auto index = m_pool.acquire(0, std::move(value));
+            m_pool[index].list = 0;  // live
+            timer_id id{ index, m_pool[index].generation };
+            m_heap.push_back({ deadline, id });
+            std::ranges::push_heap(m_heap, std::ranges::greater{}, &entry::deadline);  // min heap
+            m_size++;
+            return id;
+        }
+
+        bool cancel(timer_id id)
+        {
+            if (!m_pool.is_live(id)) return false;
+            m_pool.release(id.index);
+            m_size--;
+            return true;
+        }
+
+        // the value of a pending timer, nullptr if it fired or was cancelled
+        T const* find(timer_id id) const noexcept { return m_pool.is_live(id) ? &m_pool[id.index].value : nullptr; }
+
+        template<typename F>
+        size_t expire(US now, F&& f)
+        {
+            size_t fired = 0;
+            while (!m_heap.empty())
+            {
+                auto [deadline, id] = m_heap[0];
+                if (m_pool.is_live(id) && deadline > now) break;
+                pop();
+                if (!m_pool.is_live(id)) continue;  // cancelled
+                m_size--;
+                if constexpr (std::is_invocable_v<F&, T&&, US>) f(m_pool.release(id.index), deadline);
+                else f(m_pool.release(id.index));
+                fired++;
+            }
+            return fired;
+        }
+
+        std::optional<US> next_deadline()
+        {
+            while (!m_heap.empty() && !m_pool.is_live(m_heap[0].id)) pop();
+            if (m_heap.empty()) return std::nullopt;
+            return m_heap[0].deadline;
+        }
+
+        bool empty() const noexcept { return m_size == 0; }
+        size_t size() const noexcept { return m_size; }
+
+    private:
+        void pop()
+        {
+            std::ranges::pop_heap(m_heap, std::ranges::greater{}, &entry::deadline);
+            m_heap.pop_back();
+        }
+
+    private:
+        detail::timer_pool<T> m_pool;
+        std::vector<entry> m_heap;
+        size_t m_size{ 0 };
+    };
+}
@@ -0,0 +1,617 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "handle.h"
+#include "reactor.h"
+#include "cancellation.h"
+
+namespace coro
+{
+    /**
+     * Minimal io_uring submission / completion ring on top of the raw syscalls.
+     * Submission queue entries are only published to the kernel by `submit`, so any number of operations cost one syscall.
+     */
+    class io_uring_ring
+    {
+    public:
+        explicit io_uring_ring(unsigned entries = 256)
+        {
+            io_uring_params params{ };
+            m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (m_fd < 0) throw_errno("io_uring_setup");
+
+            m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+            m_sq_ptr = map(m_sq_size, IORING_OFF_SQ_RING);
+            m_cq_ptr = single_mmap ? m_sq_ptr : map(m_cq_size, IORING_OFF_CQ_RING);
+            m_requests = static_cast<io_uring_sqe*>(map(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+            m_requests_size = params.sq_entries * sizeof(io_uring_sqe);
+
+            auto* sq = static_cast<char*>(m_sq_ptr);
+            m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            m_sq_entries = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+            m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            m_tail = *m_sq_tail;
+
+            auto* cq = static_cast<char*>(m_cq_ptr);
+            m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        ~io_uring_ring()
+        {
+            ::munmap(m_requests, m_requests_size);
+            if (m_cq_ptr != m_sq_ptr) ::munmap(m_cq_ptr, m_cq_size);
+            ::munmap(m_sq_ptr, m_sq_size);
+            ::close(m_fd);
+        }
+
+        io_uring_ring(io_uring_ring const&) = delete;
+        io_uring_ring(io_uring_ring&&) = delete;
+        io_uring_ring& operator=(io_uring_ring const&) = delete;
+        io_uring_ring& operator=(io_uring_ring&&) = delete;
+
+        int fd() const noexcept { return m_fd; }
+
+        // next free entry, nullptr if the submission queue is full
+        io_uring_sqe* get_sqe() noexcept
+        {
+            auto head = std::atomic_ref(*m_sq_head).load(std::memory_order_acquire);
+            if (m_tail - head >= m_sq_entries) return nullptr;
+            auto index = m_tail & m_sq_mask;
+            m_sq_array[index] = index;
+            m_tail++;
+            return &m_requests[index];
+        }
+
+        /**
+         * Publish queued entries and hand them to the kernel in one io_uring_enter. Returns how many entries the kernel
+         * has not consumed, after a short count or EAGAIN / EBUSY (completion queue backed up), the next call retries them.
+         */
+        unsigned submit()
+        {
+            std::atomic_ref(*m_sq_tail).store(m_tail, std::memory_order_release);
+            auto to_submit = m_tail - std::atomic_ref(*m_sq_head).load(std::memory_order_acquire);
+            while (to_submit != 0)
+            {
+                auto n = ::syscall(__NR_io_uring_enter, m_fd, to_submit, 0, 0, nullptr, 0);
+                if (n >= 0) break;
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EBUSY) break;
+                throw_errno("io_uring_enter");
+            }
+            return m_tail - std::atomic_ref(*m_sq_head).load(std::memory_order_acquire);
+        }
+
+        // invoke `f(io_uring_cqe const&)` for every available completion
+        template<typename F>
+        size_t reap(F&& f)
+        {
+            auto head = *m_cq_head;
+            auto tail = std::atomic_ref(*m_cq_tail).load(std::memory_order_acquire);
+            size_t n = 0;
+            for (; head != tail; head++, n++)
+                f(m_cqes[head & m_cq_mask]);
+            std::atomic_ref(*m_cq_head).store(head, std::memory_order_release);
+            return n;
+        }
+
+        void register_buffers(std::span<iovec const> buffers) { do_register(IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())); }
+        void unregister_buffers() { do_register(IORING_UNREGISTER_BUFFERS, nullptr, 0); }
+        void register_files(std::span<int const> fds) { do_register(IORING_REGISTER_FILES, fds.data(), static_cast<unsigned>(fds.size())); }
+        void unregister_files() { do_register(IORING_UNREGISTER_FILES, nullptr, 0); }
+
+    private:
+        void* map(size_t size, off_t offset)
+        {
+            auto* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+            if (p == MAP_FAILED) throw_errno("mmap");
+            return p;
+        }
+
+        void do_register(unsigned opcode, void const* arg, unsigned n)
+        {
+            if (::syscall(__NR_io_uring_register, m_fd, opcode, arg, n) < 0) throw_errno("io_uring_register");
+        }
+
+        [[noreturn]] static void throw_errno(char const* what)
+        {
+            throw std::system_error(errno, std::system_category(), what);
+        }
+
+    private:
+        int m_fd{ -1 };
+        void* m_sq_ptr{ nullptr };
+        void* m_cq_ptr{ nullptr };
+        size_t m_sq_size{ 0 };
+        size_t m_cq_size{ 0 };
+        io_uring_sqe* m_requests{ nullptr };
+        size_t m_requests_size{ 0 };
+
+        unsigned* m_sq_head{ nullptr };
+        unsigned* m_sq_tail{ nullptr };
+        unsigned* m_sq_array{ nullptr };
+        unsigned m_sq_mask{ 0 };
+        unsigned m_sq_entries{ 0 };
+        unsigned m_tail{ 0 };  // local tail, published by `submit`
+
+        unsigned* m_cq_head{ nullptr };
+        unsigned* m_cq_tail{ nullptr };
+        unsigned m_cq_mask{ 0 };
+        io_uring_cqe* m_cqes{ nullptr };
+    };
+
+    class io_context;
+
+    // the fields of a submission queue entry used by io_operation (io_uring_sqe itself ends in a flexible array)
+    struct io_request
+    {
+        uint8_t opcode{ IORING_OP_NOP };
+        uint8_t flags{ 0 };  // IOSQE_*
+        uint16_t buf_index{ 0 };
+        int fd{ -1 };
+        uint64_t addr{ 0 };
+        uint64_t off{ 0 };  // also addr2
+        uint32_t len{ 0 };
+        uint32_t op_flags{ 0 };  // rw / msg / accept / open / fsync flags
+    };
+
+    /**
+     * Awaitable I/O operation, `co_await` yields the syscall result or -errno like a completion queue entry.
+     * The operation is described like a submission queue entry. With io_uring it is queued on the ring, otherwise it
+     * runs as a non-blocking syscall and waits on the epoll reactor while it would block.
+     * Cancelling the token of the awaiting task yields -ECANCELED, unless the operation completed first: an in flight
+     * operation is cancelled with IORING_OP_ASYNC_CANCEL, a fallback wait is dropped and resumed in the next loop iteration.
+     */
+    class io_operation
+    {
+    public:
+        io_operation(io_context& context, io_request const& request) noexcept : m_context(context), m_request(request) { }
+
+        // only moved before it is awaited, there is no cancellation registration to carry over
+        io_operation(io_operation&& other) noexcept : m_context(other.m_context), m_request(other.m_request) { }
+
+        // the fd is an index into the files registered with `io_context::register_files`
+        io_operation& fixed_file() & noexcept { m_request.flags |= IOSQE_FIXED_FILE; return *this; }
+        io_operation&& fixed_file() && noexcept { m_request.flags |= IOSQE_FIXED_FILE; return std::move(*this); }
+
+        bool await_ready() noexcept;
+
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> coroutine)
+        {
+            auto token = detail::cancellation_token_of(coroutine);
+            if (token.is_cancellation_requested())
+            {
+                m_result = -ECANCELED;
+                return false;
+            }
+            if constexpr (std::is_base_of_v<handle, Promise>) m_completion.copy_schedule(coroutine.promise());
+            start(coroutine);
+            if (token.can_be_cancelled()) m_cancellation.emplace(std::move(token), canceller{ this });
+            return true;
+        }
+
+        int await_resume() noexcept
+        {
+            m_cancellation.reset();
+            return m_result;
+        }
+
+    private:
+        friend class io_context;
+
+        struct completion : handle
+        {
+            io_operation* op{ nullptr };
+            void run() override final;
+        };
+
+        struct canceller
+        {
+            io_operation* op;
+            void operator()() const noexcept;
+        };
+
+        void start(std::coroutine_handle<> coroutine);
+
+        int perform() noexcept;
+        bool would_block() const noexcept { return m_result == -EAGAIN || m_result == -EWOULDBLOCK || (m_connecting && m_result == -EINPROGRESS); }
+        std::optional<io_event> direction() const noexcept;
+
+        io_context& m_context;
+        io_request m_request;
+        completion m_completion;
+        std::coroutine_handle<> m_coroutine{ nullptr };
+        int m_result{ 0 };
+        bool m_connecting{ false };
+        bool m_in_flight{ false };  // queued on the ring and not reaped yet
+        bool m_cancelled{ false };  // fallback only, dropped from the reactor by the canceller
+        std::optional<cancellation_callback<canceller>> m_cancellation;
+    };
+
+    /**
+     * Completion based I/O for a Loop.
+     * An io_uring ring is set up on first use. Operations queued while handles run are submitted in one batch per
+     * `run_once` and their completions are reaped in bulk. If io_uring is unavailable (or disabled) the same operations
+     * fall back to the epoll reactor.
+     */
+    class io_context
+    {
+    public:
+        static constexpr uint64_t current_position = static_cast<uint64_t>(-1);
+
+        explicit io_context(epoll_reactor& reactor) noexcept : m_reactor(reactor) { }
+        ~io_context() { if (m_ring) m_reactor.unwatch(m_ring->fd()); }
+
+        io_context(io_context const&) = delete;
+        io_context& operator=(io_context const&) = delete;
+
+        // returns whether io_uring is in use afterwards, only switch while no operation is pending
+        bool enable_io_uring(bool enable = true)
+        {
+            if (!enable && m_ring)
+            {
+                m_reactor.unwatch(m_ring->fd());
+                m_ring.reset();
+            }
+            m_state = enable ? state::unknown : state::disabled;
+            return ring() != nullptr;
+        }
+
+        bool uses_io_uring() { return ring() != nullptr; }
+
+        io_operation read(int fd, void* buffer, unsigned length, uint64_t offset = current_position) { return make(IORING_OP_READ, fd, buffer, length, offset); }
+        io_operation write(int fd, void const* buffer, unsigned length, uint64_t offset = current_position) { return make(IORING_OP_WRITE, fd, buffer, length, offset); }
+        io_operation readv(int fd, iovec const* iov, unsigned count, uint64_t offset = current_position) { return make(IORING_OP_READV, fd, iov, count, offset); }
+        io_operation writev(int fd, iovec const* iov, unsigned count, uint64_t offset = current_position) { return make(IORING_OP_WRITEV, fd, iov, count, offset); }
+
+        // `buffer` must lie in the buffer registered at `buffer_index`
+        io_operation read_fixed(int fd, void* buffer, unsigned length, uint64_t offset, uint16_t buffer_index)
+        {
+            auto op = make(IORING_OP_READ_FIXED, fd, buffer, length, offset);
+            op.m_request.buf_index = buffer_index;
+            return op;
+        }
+
+        io_operation write_fixed(int fd, void const* buffer, unsigned length, uint64_t offset, uint16_t buffer_index)
+        {
+            auto op = make(IORING_OP_WRITE_FIXED, fd, buffer, length, offset);
+            op.m_request.buf_index = buffer_index;
+            return op;
+        }
+
+        io_operation recv(int fd, void* buffer, unsigned length, int flags = 0)
+        {
+            auto op = make(IORING_OP_RECV, fd, buffer, length, 0);
+            op.m_request.op_flags = static_cast<uint32_t>(flags);
+            return op;
+        }
+
+        io_operation send(int fd, void const* buffer, unsigned length, int flags = 0)
+        {
+            auto op = make(IORING_OP_SEND, fd, buffer, length, 0);
+            op.m_request.op_flags = static_cast<uint32_t>(flags);
+            return op;
+        }
+
+        io_operation accept(int fd, sockaddr* address = nullptr, socklen_t* length = nullptr, int flags = SOCK_NONBLOCK | SOCK_CLOEXEC)
+        {
+            auto op = make(IORING_OP_ACCEPT, fd, address, 0, reinterpret_cast<uint64_t>(length));
+            op.m_request.op_flags = static_cast<uint32_t>(flags);
+            return op;
+        }
+
+        io_operation connect(int fd, sockaddr const* address, socklen_t length) { return make(IORING_OP_CONNECT, fd, address, 0, length); }
+
+        io_operation fsync(int fd, bool datasync = false)
+        {
+            auto op = make(IORING_OP_FSYNC, fd, nullptr, 0, 0);
+            op.m_request.op_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+            return op;
+        }
+
+        io_operation openat(int dir, char const* path, int flags, mode_t mode = 0)
+        {
+            auto op = make(IORING_OP_OPENAT, dir, path, mode, 0);
+            op.m_request.op_flags = static_cast<uint32_t>(flags);
+            return op;
+        }
+
+        // registered buffers are pinned once instead of per operation
+        void register_buffers(std::span<iovec const> buffers)
+        {
+            if (auto* r = ring()) r->register_buffers(buffers);
+        }
+
+        void unregister_buffers()
+        {
+            if (auto* r = ring()) r->unregister_buffers();
+        }
+
+        // fixed files skip the per operation fd table lookup, see `io_operation::fixed_file`
+        void register_files(std::span<int const> fds)
+        {
+            if (auto* r = ring()) r->register_files(fds);
+            m_files.assign(fds.begin(), fds.end());
+        }
+
+        void unregister_files()
+        {
+            if (auto* r = ring()) r->unregister_files();
+            m_files.clear();
+        }
+
+        // number of operations (and cancellations) queued on the ring and not completed yet
+        size_t pending() const noexcept { return m_pending; }
+
+        // hand the operations queued since the last call, and those the kernel did not take then, to the kernel
+        void submit()
+        {
+            if (m_ring && m_unsubmitted != 0) m_unsubmitted = m_ring->submit();
+        }
+
+        // entries the kernel has not taken yet, the loop must not park on them
+        size_t unsubmitted() const noexcept { return m_unsubmitted; }
+
+        // pass the completion handle of every finished operation to `ready`
+        template<typename F>
+        size_t reap(F&& ready)
+        {
+            if (!m_ring || m_pending == 0) return 0;
+            return m_ring->reap([&](io_uring_cqe const& cqe) {
+                m_pending--;
+                if (cqe.user_data == 0) return;  // an IORING_OP_ASYNC_CANCEL, the cancelled operation completes on its own
+                auto* op = reinterpret_cast<io_operation*>(static_cast<uintptr_t>(cqe.user_data));
+                op->m_result = cqe.res;
+                op->m_in_flight = false;
+                ready(handle_wrapper{ op->m_completion.get_handle_id(), &op->m_completion });
+            });
+        }
+
+    private:
+        friend class io_operation;
+
+        enum class state : uint8_t { unknown, enabled, disabled };
+
+        io_uring_ring* ring()
+        {
+            if (m_state == state::unknown)
+            {
+                try
+                {
+                    m_ring.emplace();
+                    m_reactor.watch(m_ring->fd());  // completions interrupt the reactor wait
+                    m_state = state::enabled;
+                }
+                catch (std::system_error const&)
+                {
+                    m_ring.reset();
+                    m_state = state::disabled;  // e.g. ENOSYS or blocked by seccomp
+                }
+            }
+            return m_ring ? &*m_ring : nullptr;
+        }
+
+        io_operation make(uint8_t opcode, int fd, void const* address, unsigned length, uint64_t offset)
+        {
+            ring();
+            io_request request;
+            request.opcode = opcode;
+            request.fd = fd;
+            request.addr = reinterpret_cast<uint64_t>(address);
+            request.len = length;
+            request.off = offset;
+            return { *this, request };
+        }
+
+        io_uring_sqe* next_sqe()
+        {
+            auto* sqe = m_ring->get_sqe();
+            if (sqe == nullptr)  // full, flush early
+            {
+                m_unsubmitted = m_ring->submit();
+                sqe = m_ring->get_sqe();
+                if (sqe == nullptr) throw std::system_error(EBUSY, std::system_category(), "io_uring submission queue full");
+            }
+            std::memset(static_cast<void*>(sqe), 0, sizeof(io_uring_sqe));
+            m_unsubmitted++;
+            m_pending++;
+            return sqe;
+        }
+
+        void queue(io_operation& op)
+        {
+            auto* sqe = next_sqe();
+            auto const& request = op.m_request;
+            sqe->opcode = request.opcode;
+            sqe->flags = request.flags;
+            sqe->buf_index = request.buf_index;
+            sqe->fd = request.fd;
+            sqe->addr = request.addr;
+            sqe->off = request.off;
+            sqe->len = request.len;
+            sqe->rw_flags = request.op_flags;
+            sqe->user_data = reinterpret_cast<uint64_t>(&op);
+            op.m_in_flight = true;
+        }
+
+        // submitted with the next batch, the operation then completes with -ECANCELED unless it already finished
+        void queue_cancel(io_operation& op)
+        {
+            auto* sqe = next_sqe();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&op);
+            sqe->user_data = 0;
+        }
+
+        int file(io_operation const& op) const noexcept
+        {
+            if (!(op.m_request.flags & IOSQE_FIXED_FILE)) return op.m_request.fd;
+            auto index = static_cast<size_t>(op.m_request.fd);
+            return index < m_files.size() ? m_files[index] : -1;
+        }
+
+    private:
+        epoll_reactor& m_reactor;
+        std::optional<io_uring_ring> m_ring;
+        state m_state{ state::unknown };
+        std::vector<int> m_files;  // registered files, also used by the fallback
+        size_t m_unsubmitted{ 0 };
+        size_t m_pending{ 0 };
+    };
+
+    inline bool io_operation::await_ready() noexcept
+    {
+        if (m_context.m_ring) return false;
+        m_result = perform();
+        return !would_block();
+    }
+
+    inline void io_operation::start(std::coroutine_handle<> coroutine)
+    {
+        m_coroutine = coroutine;
+        m_completion.op = this;
+        if (m_context.m_ring) m_context.queue(*this);
+        else m_context.m_reactor.add_waiter(m_context.file(*this), *direction(), m_completion);
+    }
+
+    inline void io_operation::completion::run()
+    {
+        if (!op->m_context.m_ring && !op->m_cancelled)
+        {
+            op->m_result = op->perform();
+            if (op->would_block())  // spurious edge, wait again
+            {
+                op->m_context.m_reactor.add_waiter(op->m_context.file(*op), *op->direction(), *this);
+                return;
+            }
+        }
+        op->m_coroutine.resume();
+    }
+
+    inline void io_operation::canceller::operator()() const noexcept
+    {
+        auto& context = op->m_context;
+        if (context.m_ring)
+        {
+            if (!op->m_in_flight) return;
+            try
+            {
+                context.queue_cancel(*op);
+            }
+            catch (std::system_error const&)
+            {
+                // the ring is full even after a flush, the operation completes normally
+            }
+            return;
+        }
+
+        auto direction = op->direction();
+        if (!direction || !context.m_reactor.cancel_waiter(context.file(*op), *direction)) return;
+        op->m_result = -ECANCELED;
+        op->m_cancelled = true;  // the completion resumes the coroutine in the next iteration, without retrying
+    }
+
+    inline std::optional<io_event> io_operation::direction() const noexcept
+    {
+        switch (m_request.opcode)
+        {
+        case IORING_OP_READ: case IORING_OP_READV: case IORING_OP_READ_FIXED: case IORING_OP_RECV: case IORING_OP_ACCEPT:
+            return io_event::read;
+        case IORING_OP_WRITE: case IORING_OP_WRITEV: case IORING_OP_WRITE_FIXED: case IORING_OP_SEND: case IORING_OP_CONNECT:
+            return io_event::write;
+        default:
+            return std::nullopt;  // never blocks on readiness
+        }
+    }
+
+    // the fallback, a non-blocking syscall equivalent to the submission queue entry
+    inline int io_operation::perform() noexcept
+    {
+        auto fd = m_context.file(*this);
+        auto* address = reinterpret_cast<void*>(static_cast<uintptr_t>(m_request.addr));
+        auto offset = static_cast<off_t>(m_request.off);
+        bool positioned = m_request.off != io_context::current_position;
+        long r = -1;
+        switch (m_request.opcode)
+        {
+        case IORING_OP_READ: case IORING_OP_READ_FIXED:
+            r = positioned ? ::pread(fd, address, m_request.len, offset) : ::read(fd, address, m_request.len);
+            break;
+        case IORING_OP_WRITE: case IORING_OP_WRITE_FIXED:
+            r = positioned ? ::pwrite(fd, address, m_request.len, offset) : ::write(fd, address, m_request.len);
+            break;
+        case IORING_OP_READV:
+            r = positioned ? ::preadv(fd, static_cast<iovec const*>(address), static_cast<int>(m_request.len), offset)
+                           : ::readv(fd, static_cast<iovec const*>(address), static_cast<int>(m_request.len));
+            break;
+        case IORING_OP_WRITEV:
+            r = positioned ? ::pwritev(fd, static_cast<iovec const*>(address), static_cast<int>(m_request.len), offset)
+                           : ::writev(fd, static_cast<iovec const*>(address), static_cast<int>(m_request.len));
+            break;
+        case IORING_OP_RECV:
+            r = ::recv(fd, address, m_request.len, static_cast<int>(m_request.op_flags) | MSG_DONTWAIT);
+            break;
+        case IORING_OP_SEND:
+            r = ::send(fd, address, m_request.len, static_cast<int>(m_request.op_flags) | MSG_DONTWAIT | MSG_NOSIGNAL);
+            break;
+        case IORING_OP_ACCEPT:
+            r = ::accept4(fd, static_cast<sockaddr*>(address), reinterpret_cast<socklen_t*>(static_cast<uintptr_t>(m_request.off)), static_cast<int>(m_request.op_flags));
+            break;
+        case IORING_OP_CONNECT:
+            if (m_connecting)  // resumed by writability, fetch the outcome
+            {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0) return -errno;
+                m_connecting = false;
+                return -error;
+            }
+            r = ::connect(fd, static_cast<sockaddr const*>(address), static_cast<socklen_t>(m_request.off));
+            if (r < 0 && errno == EINPROGRESS) m_connecting = true;
+            break;
+        case IORING_OP_FSYNC:
+            r = (m_request.op_flags & IORING_FSYNC_DATASYNC) ? ::fdatasync(fd) : ::fsync(fd);
+            break;
+        case IORING_OP_OPENAT:
+            r = ::openat(m_request.fd, static_cast<char const*>(address), static_cast<int>(m_request.op_flags), static_cast<mode_t>(m_request.len));
+            break;
+        default:
+            return -EINVAL;
+        }
+        return r < 0 ? -errno : static_cast<int>(r);
+    }
+}
+
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "task.h"
+
+namespace coro
+{
+    namespace detail
+    {
+        /**
+         * Counts down the children of a `when_all` plus one for the awaiting coroutine, which arrives once all children are started.
+         * Whoever arrives last resumes the awaiting coroutine, a child by symmetric transfer from its final awaiter,
+         * the awaiting coroutine by not suspending at all.
+         */
+        class when_all_latch final : public completion_hook
+        {
+        public:
+            explicit when_all_latch(size_t children) noexcept : m_count(children + 1) { }
+
+            std::coroutine_handle<> on_complete(promise_base&) noexcept override
+            {
+                return arrive() ? m_awaiting : std::noop_coroutine();
+            }
+
+            // true for the last arrival
+            bool arrive() noexcept { return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+            // start `child`, a task that already completed simply arrives
+            template<typename Ret, typename Promise>
+            void start(task<Ret>& child, std::coroutine_handle<Promise> awaiting)
+            {
+                if (child.is_done())
+                {
+                    arrive();
+                    return;
+                }
+                m_awaiting = awaiting;
+                child.promise().set_continuation(awaiting);  // backtraces and the cancellation token only
+                child.promise().set_completion_hook(this);
+                child.handle().resume();
+            }
+
+        private:
+            std::atomic<size_t> m_count;
+            std::coroutine_handle<> m_awaiting{ nullptr };
+        };
+
+        // void results are represented by std::monostate
+        template<typename Ret>
+        auto take_result(task<Ret>& t)
+        {
+            if constexpr (std::is_void_v<Ret>)
+            {
+                t.promise().result();
+                return std::monostate{ };
+            }
+            else
+                return std::move(t.promise()).result();
+        }
+    }
+
+    /**
+     * Awaitable of `when_all(tasks...)`, starts every task and resumes once all of them completed.
+     * The latch lives in the awaitable itself, so awaiting allocates nothing beyond the tasks' frames.
+     * Results are returned as a tuple, the first exception in argument order is rethrown.
+     */
+    template<typename... Rets>
+    class when_all_awaitable
+    {
+    public:
+        explicit when_all_awaitable(task<Rets>&&... tasks) : m_tasks(std::move(tasks)...) { }
+
+        when_all_awaitable(when_all_awaitable const&) = delete;
+        when_all_awaitable& operator=(when_all_awaitable const&) = delete;
+
+        bool await_ready() const noexcept { return sizeof...(Rets) == 0; }
+
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> awaiting)
+        {
+            std::apply([&](auto&... tasks) { (m_latch.start(tasks, awaiting), ...); }, m_tasks);
+            return !m_latch.arrive();  // everything finished synchronously, carry on
+        }
+
+        std::tuple<decltype(detail::take_result(std::declval<task<Rets>&>()))...> await_resume()
+        {
+            return std::apply([](auto&... tasks) { return std::tuple{ detail::take_result(tasks)... }; }, m_tasks);
+        }
+
+    private:
+        std::tuple<task<Rets>...> m_tasks;
+        detail::when_all_latch m_latch{ sizeof...(Rets) };
+    };
+
+    // range version, results are returned in order as a vector, nothing for void tasks
+    template<typename Ret>
+    class when_all_range_awaitable
+    {
+    public:
+        explicit when_all_range_awaitable(std::vector<task<Ret>> tasks) : m_tasks(std::move(tasks)), m_latch(m_tasks.size()) { }
+
+        when_all_range_awaitable(when_all_range_awaitable const&) = delete;
+        when_all_range_awaitable& operator=(when_all_range_awaitable const&) = delete;
+
+        bool await_ready() const noexcept { return m_tasks.empty(); }
+
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> awaiting)
+        {
+            for (auto& t : m_tasks) m_latch.start(t, awaiting);
+            return !m_latch.arrive();
+        }
+
+        auto await_resume()
+        {
+            if constexpr (std::is_void_v<Ret>)
+            {
+                for (auto& t : m_tasks) t.promise().result();
+            }
+            else
+            {
+                std::vector<Ret> results;
+                results.reserve(m_tasks.size());
+                for (auto& t : m_tasks) results.push_back(std::move(t.promise()).result());
+                return results;
+            }
+        }
+
+    private:
+        std::vector<task<Ret>> m_tasks;
+        detail::when_all_latch m_latch;
+    };
+
+    // run `tasks` concurrently, `co_await when_all(a(), b())` yields a tuple of their results
+    template<typename... Rets>
+    when_all_awaitable<Rets...> when_all(task<Rets>... tasks)
+    {
+        return when_all_awaitable<Rets...>(std::move(tasks)...);
+    }
+
+    template<typename Ret>
+    when_all_range_awaitable<Ret> when_all(std::vector<task<Ret>> tasks)
+    {
+        return when_all_range_awaitable<Ret>(std::move(tasks));
+    }
+}
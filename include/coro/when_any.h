@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "task.h"
+
+namespace coro
+{
+    template<typename Ret>
+    struct when_any_result
+    {
+        size_t index;
+        Ret value;
+    };
+
+    template<>
+    struct when_any_result<void>
+    {
+        size_t index;
+    };
+
+    namespace detail
+    {
+        /**
+         * Shared state of a `when_any`, the single allocation of the combinator.
+         * Owns the tasks and is reference counted by the awaitable and every started child,
+         * so children still running when the winner resumes the awaiting coroutine are detached:
+         * they run to completion and the last one to finish frees the state with all frames.
+         */
+        template<typename Ret, typename Tasks>
+        class when_any_state final : public completion_hook
+        {
+        public:
+            explicit when_any_state(Tasks tasks) noexcept : m_tasks(std::move(tasks)), m_refs(m_tasks.size() + 1) { }
+
+            std::coroutine_handle<> on_complete(promise_base& child) noexcept override
+            {
+                promise_base* expected = nullptr;
+                auto next = std::coroutine_handle<>(std::noop_coroutine());
+                if (m_winner.compare_exchange_strong(expected, &child, std::memory_order_acq_rel, std::memory_order_relaxed) && resume())
+                    next = m_awaiting;
+                release();  // not the last reference if we won, the awaitable holds one
+                return next;
+            }
+
+            /**
+             * Start the tasks until one wins, those not started by then are cancelled.
+             * Returns false if the winner completed synchronously.
+             */
+            template<typename Promise>
+            bool start(std::coroutine_handle<Promise> awaiting)
+            {
+                m_awaiting = awaiting;
+                size_t i = 0;
+                for (; i < m_tasks.size() && m_winner.load(std::memory_order_acquire) == nullptr; i++)
+                {
+                    auto& t = m_tasks[i];
+                    if (t.is_done())  // completed before, wins right away
+                    {
+                        on_complete(t.promise());
+                        continue;
+                    }
+                    t.promise().inherit_cancellation_token(awaiting);  // no continuation, losers outlive the awaiting frame
+                    t.promise().inherit_schedule(awaiting);
+                    t.promise().set_completion_hook(this);
+                    t.handle().resume();
+                }
+                m_refs.fetch_sub(m_tasks.size() - i, std::memory_order_relaxed);  // never started
+                return !resume();
+            }
+
+            when_any_result<Ret> result()
+            {
+                auto* winner = m_winner.load(std::memory_order_acquire);
+                size_t index = 0;
+                while (&m_tasks[index].promise() != winner) index++;
+                if constexpr (std::is_void_v<Ret>)
+                {
+                    m_tasks[index].promise().result();
+                    return { index };
+                }
+                else
+                    return { index, std::move(m_tasks[index].promise()).result() };
+            }
+
+            void release() noexcept
+            {
+                if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+            }
+
+        private:
+            // the winner and the awaiting coroutine finishing `start` race for resuming it, the second one does
+            bool resume() noexcept { return m_resume.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+            Tasks m_tasks;
+            std::atomic<size_t> m_refs;
+            std::atomic<promise_base*> m_winner{ nullptr };
+            std::atomic<int> m_resume{ 2 };
+            std::coroutine_handle<> m_awaiting{ nullptr };
+        };
+    }
+
+    /**
+     * Awaitable of `when_any`, starts the tasks in order and resumes with the index and result of the first one to complete.
+     * An exception of the winner is rethrown. The other tasks are not awaited:
+     * those not started yet never run, running ones are detached and destroyed once they finish.
+     */
+    template<typename Ret, typename Tasks>
+    class when_any_awaitable
+    {
+        using state_type = detail::when_any_state<Ret, Tasks>;
+
+    public:
+        explicit when_any_awaitable(Tasks tasks)
+        {
+            if (tasks.size() == 0) throw std::invalid_argument("when_any needs at least one task");
+            m_state = new state_type(std::move(tasks));
+        }
+
+        ~when_any_awaitable()
+        {
+            if (m_state == nullptr) return;
+            if (m_started) m_state->release();
+            else delete m_state;
+        }
+
+        when_any_awaitable(when_any_awaitable&& other) noexcept
+            : m_state(std::exchange(other.m_state, nullptr)), m_started(other.m_started) { }
+        when_any_awaitable& operator=(when_any_awaitable&&) = delete;
+
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        bool await_suspend(std::coroutine_handle<Promise> awaiting)
+        {
+            m_started = true;
+            return m_state->start(awaiting);
+        }
+
+        when_any_result<Ret> await_resume() { return m_state->result(); }
+
+    private:
+        state_type* m_state{ nullptr };
+        bool m_started{ false };
+    };
+
+    template<typename Ret, typename... Rest>
+        requires (std::same_as<Ret, Rest> && ...)
+    auto when_any(task<Ret> first, task<Rest>... rest)
+    {
+        using tasks_type = std::array<task<Ret>, sizeof...(Rest) + 1>;
+        return when_any_awaitable<Ret, tasks_type>(tasks_type{ std::move(first), std::move(rest)... });
+    }
+
+    template<typename Ret>
+    auto when_any(std::vector<task<Ret>> tasks)
+    {
+        return when_any_awaitable<Ret, std::vector<task<Ret>>>(std::move(tasks));
+    }
+}
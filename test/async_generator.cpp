@@ -0,0 +1,99 @@
+#include "coro/async_generator.h"
+#include "coro/event.h"
+#include "coro/loop.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+
+struct counted
+{
+    explicit counted(int v) : value(v) { }
+    counted(counted const& other) : value(other.value) { copies++; }
+    int value;
+    inline static int copies = 0;
+};
+
+task<int> fetch(int i) { co_return i * 10; }
+
+// awaits a task and an event between yields
+async_generator<counted> records(event const& ready, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (i == 2) co_await ready;
+        counted c{ co_await fetch(i) };
+        co_yield c;  // the consumer sees `c` in this frame
+    }
+}
+
+async_generator<int> failing()
+{
+    co_yield 1;
+    throw std::runtime_error("broken");
+}
+
+task<> sum_by_iterator(async_generator<counted>& gen, std::vector<int>& out)
+{
+    for (auto it = co_await gen.begin(); it != gen.end(); co_await ++it)
+        out.push_back(it->value);
+}
+
+int main()
+{
+    {
+        event ready;
+        std::vector<int> out;
+        auto gen = records(ready, 4);
+        auto t = sum_by_iterator(gen, out);
+        t.resume();
+        RequireTrue(!t.is_done() && (out == std::vector<int>{ 0, 10 }));  // waiting inside the generator
+        ready.set();
+        RequireTrue(t.is_done() && (out == std::vector<int>{ 0, 10, 20, 30 }));
+        RequireTrue(counted::copies == 0);
+    }
+
+    // next(), exceptions reach the consumer
+    {
+        std::vector<int> out;
+        bool caught = false;
+        auto body = [&]() -> task<> {
+            auto gen = failing();
+            try
+            {
+                while (auto* v = co_await gen.next()) out.push_back(*v);
+            }
+            catch (std::runtime_error const&)
+            {
+                caught = true;
+            }
+        };
+        auto t = body();
+        t.resume();
+        RequireTrue(t.is_done() && caught && (out == std::vector<int>{ 1 }));
+    }
+
+    // the generator waits on an event set from a loop task
+    {
+        Loop loop;
+        event tick;
+        std::vector<int> out;
+        auto gen = records(tick, 3);
+        auto consumer = [&]() -> task<> {
+            while (auto* v = co_await gen.next()) out.push_back(v->value);
+        };
+        auto setter = [&]() -> task<> { tick.set(); co_return; };
+        auto c = consumer();
+        auto s = setter();
+        loop.call(c);
+        loop.call_after(std::chrono::milliseconds(1), s);
+        loop.run_until_complete();
+        RequireTrue(c.is_done() && (out == std::vector<int>{ 0, 10, 20 }));
+    }
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "coro/cancellation.h"
+#include "coro/event.h"
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+// checks the token it inherited after every wake up
+task<int> worker(auto_reset_event& tick, int& rounds)
+{
+    auto token = co_await current_cancellation_token();
+    while (true)
+    {
+        co_await tick;
+        token.throw_if_cancellation_requested();
+        rounds++;
+    }
+}
+
+task<bool> request(auto_reset_event& tick, int& rounds)
+{
+    try
+    {
+        co_await worker(tick, rounds);
+    }
+    catch (operation_cancelled const&)
+    {
+        co_return true;
+    }
+    co_return false;
+}
+
+task<bool> wait_readable(Loop& loop, int fd)
+{
+    try
+    {
+        co_await loop.readable(fd);
+    }
+    catch (operation_cancelled const&)
+    {
+        co_return true;
+    }
+    co_return false;
+}
+
+task<int> read_one(Loop& loop, int fd)
+{
+    char c;
+    co_return co_await loop.io().read(fd, &c, 1);
+}
+
+task<> cancel_after(cancellation_source& source)
+{
+    source.request_cancellation();
+    co_return;
+}
+
+void check_io(bool use_io_uring)
+{
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK) != 0) return;
+
+    Loop loop;
+    loop.io().enable_io_uring(use_io_uring);
+    cancellation_source source;
+    auto r = read_one(loop, fds[0]);
+    r.promise().set_cancellation_token(source.token());
+    auto c = cancel_after(source);
+    loop.call(r);
+    loop.call_after(10ms, c);
+    loop.run_until_complete();
+    RequireTrue(r.is_done() && r.promise().result() == -ECANCELED);
+
+    loop.forget(fds[0]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main()
+{
+    // callbacks run once, right away if registered late, not at all once destroyed
+    {
+        cancellation_source source;
+        int called = 0, dropped = 0;
+        cancellation_callback first{ source.token(), [&] { called++; } };
+        {
+            cancellation_callback gone{ source.token(), [&] { dropped++; } };
+        }
+        RequireTrue(source.request_cancellation() && !source.request_cancellation());
+        cancellation_callback late{ source.token(), [&] { called++; } };
+        RequireTrue(called == 2 && dropped == 0 && source.token().is_cancellation_requested());
+        RequireTrue(!cancellation_token{ }.can_be_cancelled());
+    }
+
+    // the token reaches the awaited task, which stops at its next check
+    {
+        cancellation_source source;
+        auto_reset_event tick;
+        int rounds = 0;
+        auto t = request(tick, rounds);
+        t.promise().set_cancellation_token(source.token());
+        t.resume();
+        tick.set();
+        RequireTrue(rounds == 1 && !t.is_done());
+        source.request_cancellation();
+        tick.set();
+        RequireTrue(t.is_done() && t.promise().result() && rounds == 1);
+    }
+
+    // a pending call_after timer is dropped, the task never runs
+    {
+        Loop loop;
+        cancellation_source source;
+        bool ran = false;
+        auto body = [&]() -> task<> { ran = true; co_return; };
+        auto t = body();
+        t.promise().set_cancellation_token(source.token());
+        auto c = cancel_after(source);
+        loop.call_after(50ms, t);
+        loop.call_after(1ms, c);
+        auto start = std::chrono::steady_clock::now();
+        loop.run_until_complete();
+        RequireTrue(!ran && std::chrono::steady_clock::now() - start < 50ms);
+    }
+
+    // a readiness wait completes with a cancellation error
+    {
+        int fds[2];
+        if (::pipe2(fds, O_NONBLOCK) != 0) return 1;
+        Loop loop;
+        cancellation_source source;
+        auto w = wait_readable(loop, fds[0]);
+        w.promise().set_cancellation_token(source.token());
+        auto c = cancel_after(source);
+        loop.call(w);
+        loop.call_after(10ms, c);
+        loop.run_until_complete();
+        RequireTrue(w.is_done() && w.promise().result());
+        loop.forget(fds[0]);
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    // completion based reads yield -ECANCELED
+    check_io(true);
+    check_io(false);
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "coro/async_channel.h"
+#include "coro/thread_pool.h"
+#include <memory>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+
+task<> produce(async_channel<int>& ch, int from, int to, bool close)
+{
+    for (int i = from; i < to; i++) co_await ch.send(i);
+    if (close) ch.close();
+}
+
+task<> consume(async_channel<int>& ch, std::vector<int>& received)
+{
+    while (auto v = co_await ch.recv()) received.push_back(*v);
+}
+
+task<> produce_on(thread_pool& pool, async_channel<int>& ch, int count, std::atomic<int>& done)
+{
+    for (int i = 1; i <= count; i++)
+    {
+        co_await pool.schedule();
+        co_await ch.send(i);
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+task<> consume_on(thread_pool& pool, async_channel<int>& ch, std::atomic<long>& sum, std::atomic<int>& received, std::atomic<int>& done)
+{
+    co_await pool.schedule();
+    while (auto v = co_await ch.recv())
+    {
+        sum.fetch_add(*v);
+        received.fetch_add(1);
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+void wait_for(std::atomic<int>& done, int count)
+{
+    for (int d = done.load(); d < count; d = done.load()) done.wait(d);
+}
+
+int main()
+{
+    // the producer suspends when full, the consumer when empty
+    {
+        async_channel<int> ch{ 2 };
+        std::vector<int> received;
+        auto p = produce(ch, 0, 10, true);
+        p.resume();
+        RequireTrue(!p.is_done() && ch.size() == 2);
+        auto c = consume(ch, received);
+        c.resume();  // each receive lets the producer refill, until it closes the channel
+        RequireTrue(p.is_done() && c.is_done());
+        RequireTrue((received == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+    }
+
+    // close wakes waiting receivers, sending afterwards fails
+    {
+        async_channel<int> ch{ 4 };
+        std::vector<int> received;
+        auto c = consume(ch, received);
+        c.resume();
+        RequireTrue(!c.is_done());
+        ch.close();
+        RequireTrue(c.is_done() && received.empty());
+        RequireTrue(!ch.try_send(1));
+    }
+
+    // batches, move-only items, draining after close
+    {
+        async_channel<std::unique_ptr<int>> ch{ 3 };  // rounded up to 4
+        std::vector<std::unique_ptr<int>> in;
+        for (int i = 0; i < 6; i++) in.push_back(std::make_unique<int>(i));
+        RequireTrue(ch.capacity() == 4 && ch.try_send_n(in.begin(), in.size()) == 4);
+        RequireTrue(in[3] == nullptr && in[4] != nullptr);
+        ch.close();
+
+        std::vector<std::unique_ptr<int>> out;
+        RequireTrue(ch.try_recv_n(std::back_inserter(out), 3) == 3 && *out[2] == 2);
+        auto last = ch.try_recv();
+        RequireTrue(last && **last == 3 && !ch.try_recv());
+    }
+
+    // many producers and consumers on a pool
+    {
+        async_channel<int> ch{ 16 };
+        std::atomic<long> sum{ 0 };
+        std::atomic<int> received{ 0 }, producers{ 0 }, consumers{ 0 };
+        std::vector<task<>> tasks;
+        {
+            thread_pool pool{ 4 };
+            for (int i = 0; i < 4; i++) tasks.push_back(consume_on(pool, ch, sum, received, consumers));
+            for (int i = 0; i < 4; i++) tasks.push_back(produce_on(pool, ch, 1000, producers));
+            for (auto& t : tasks) pool.call(t);
+            wait_for(producers, 4);
+            ch.close();
+            wait_for(consumers, 4);
+        }
+        RequireTrue(received.load() == 4000 && sum.load() == 4 * 500500L);
+    }
+
+    return 0;
+}
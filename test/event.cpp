@@ -1,6 +1,9 @@
 #include "coro/event.h"
 #include "coro/task.h"
+#include "coro/loop.h"
+#include "coro/thread_pool.h"
 #include <thread>
+#include <vector>
 #include <chrono>
 #include <fmt/core.h>
 
@@ -11,6 +14,17 @@ using namespace coro;
 
 void trigger(event& e) { e.set(); }
 task<int> waiter(event const& e) { co_await e; co_return 1; }
+task<> ordered(event const& e, std::vector<int>& order, int id) { co_await e; order.push_back(id); }
+task<> consume(auto_reset_event& e, int& count) { co_await e; count++; }
+task<> once(oneshot_event& e) { co_await e; }
+
+task<> pooled(thread_pool& pool, event const& e, std::atomic<int>& done)
+{
+    co_await pool.schedule();
+    co_await e;
+    done.fetch_add(1);
+    done.notify_one();
+}
 
 int main()
 {
@@ -18,14 +32,15 @@ int main()
         event e{};
         RequireFalse(e.is_set());
 
-        auto t = [&e]() -> task<int> {
+        auto body = [&e]() -> task<int> {
             auto start = std::chrono::high_resolution_clock::now();
             co_await e;
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed = end - start;
             fmt::print("time: {}\n", elapsed.count());
             co_return 1;
-        }();
+        };
+        auto t = body();  // the closure outlives the coroutine
         t.resume();
         RequireFalse(t.is_done());
 
@@ -74,5 +89,88 @@ int main()
         RequireTrue(t2.promise().result() == 1);
     }
 
+    // FIFO, inline or handed over to a loop as one batch
+    {
+        event e{};
+        std::vector<int> order;
+        auto t1 = ordered(e, order, 1);
+        auto t2 = ordered(e, order, 2);
+        auto t3 = ordered(e, order, 3);
+        t1.resume();
+        t2.resume();
+        t3.resume();
+        e.set();
+        RequireTrue((order == std::vector<int>{ 1, 2, 3 }));
+
+        Loop loop;
+        e.reset();
+        order.clear();
+        auto t4 = ordered(e, order, 4);
+        auto t5 = ordered(e, order, 5);
+        t4.resume();
+        t5.resume();
+        e.set(loop);
+        RequireTrue(e.is_set() && order.empty());
+        loop.run_until_complete();
+        RequireTrue((order == std::vector<int>{ 4, 5 }));
+    }
+
+    // waiters resumed on a thread pool
+    {
+        event e{};
+        std::atomic<int> done{ 0 };
+        std::vector<task<>> tasks;
+        {
+            thread_pool pool{ 2 };
+            for (int i = 0; i < 4; i++) tasks.push_back(pooled(pool, e, done));
+            for (auto& t : tasks) pool.call(t);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));  // let them suspend, a late one finds the event set
+            e.set(pool);
+            for (int d = done.load(); d < 4; d = done.load()) done.wait(d);
+        }
+        RequireTrue(done.load() == 4);
+    }
+
+    // auto reset: one waiter per set, a set without waiters is kept for the next one
+    {
+        auto_reset_event e;
+        int count = 0;
+        auto t1 = consume(e, count);
+        auto t2 = consume(e, count);
+        t1.resume();
+        t2.resume();
+        e.set();
+        RequireTrue(count == 1 && t1.is_done() && !t2.is_done());
+        e.set();
+        RequireTrue(count == 2 && !e.is_set());
+        e.set();
+        e.set();
+        RequireTrue(e.is_set());
+        auto t3 = consume(e, count);
+        t3.resume();
+        RequireTrue(t3.is_done() && !e.is_set());
+    }
+
+    {
+        oneshot_event e;
+        auto t1 = once(e);
+        t1.resume();
+        RequireFalse(t1.is_done());
+        e.set();
+        RequireTrue(t1.is_done() && e.is_set());
+        auto t2 = once(e);
+        t2.resume();
+        RequireTrue(t2.is_done());
+
+        Loop loop;
+        oneshot_event deferred;
+        auto t3 = once(deferred);
+        t3.resume();
+        deferred.set(loop);
+        RequireFalse(t3.is_done());
+        loop.run_until_complete();
+        RequireTrue(t3.is_done());
+    }
+
     return 0;
 }
\ No newline at end of file
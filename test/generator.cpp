@@ -1,9 +1,86 @@
 #include "coro/generator.h"
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 #include <fmt/core.h>
 
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
 using namespace coro;
 
+struct node
+{
+    int value;
+    std::unique_ptr<node> left, right;
+};
+
+std::unique_ptr<node> build(int lo, int hi)
+{
+    if (lo > hi) return nullptr;
+    int mid = (lo + hi) / 2;
+    return std::make_unique<node>(node{ mid, build(lo, mid - 1), build(mid + 1, hi) });
+}
+
+// in-order, each element is one resume of the innermost frame whatever the depth
+generator<int> walk(node const* n)
+{
+    if (n == nullptr) co_return;
+    co_yield elements_of(walk(n->left.get()));
+    co_yield n->value;
+    co_yield elements_of(walk(n->right.get()));
+}
+
+generator<int> countdown(int n)
+{
+    if (n == 0) co_return;
+    co_yield n;
+    co_yield elements_of(countdown(n - 1));
+}
+
+struct counted
+{
+    explicit counted(int v) : value(v) { }
+    counted(counted const& other) : value(other.value) { copies++; }
+    int value;
+    inline static int copies = 0;
+};
+
+generator<counted> lvalues()
+{
+    counted a{ 1 };
+    co_yield a;  // in place
+    counted const b{ 2 };
+    co_yield b;  // copied, b is const
+}
+
+generator<int> throwing()
+{
+    co_yield 1;
+    throw std::runtime_error("child");
+}
+
+generator<int> parent()
+{
+    std::vector<int> v{ 7, 8 };
+    co_yield elements_of(v);
+    co_yield elements_of(throwing());
+}
+
+generator<int> pair()
+{
+    co_yield 1;
+    co_yield 2;
+}
+
+// the second delegation finds `g` finished and yields nothing
+generator<int> twice(generator<int>& g)
+{
+    co_yield elements_of(g);
+    co_yield elements_of(g);
+    co_yield 3;
+}
+
 int main()
 {
     auto g = []() -> generator<std::string> {  co_yield "Hello"; };
@@ -15,5 +92,48 @@ int main()
         if (e > 5) break;
         else fmt::print("{}\n", e);
 
+    {
+        auto root = build(1, 100);
+        std::vector<int> out;
+        for (auto v : walk(root.get())) out.push_back(v);
+        bool sorted = out.size() == 100;
+        for (int i = 0; sorted && i < 100; i++) sorted = out[static_cast<size_t>(i)] == i + 1;
+        RequireTrue(sorted);
+    }
+
+    // deep delegation chains neither recurse on the stack nor slow down per element
+    {
+        long sum = 0;
+        for (auto v : countdown(2000)) sum += v;
+        RequireTrue(sum == 2000L * 2001 / 2);
+    }
+
+    {
+        std::vector<int> out;
+        for (auto const& c : lvalues()) out.push_back(c.value);
+        RequireTrue((out == std::vector<int>{ 1, 2 }) && counted::copies == 1);
+    }
+
+    {
+        std::vector<int> out;
+        bool caught = false;
+        try
+        {
+            for (auto v : parent()) out.push_back(v);
+        }
+        catch (std::runtime_error const&)
+        {
+            caught = true;
+        }
+        RequireTrue(caught && (out == std::vector<int>{ 7, 8, 1 }));
+    }
+
+    {
+        auto g = pair();
+        std::vector<int> out;
+        for (auto v : twice(g)) out.push_back(v);
+        RequireTrue((out == std::vector<int>{ 1, 2, 3 }));
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,5 +1,13 @@
+// the metrics checks below are part of the test
+#ifndef CORO_LOOP_METRICS
+#define CORO_LOOP_METRICS 1
+#endif
+
 #include "coro/loop.h"
 #include "coro/task.h"
+#include <ctime>
+#include <thread>
+#include <vector>
 
 using namespace coro;
 
@@ -39,8 +47,64 @@ int main()
     loop.call_after(std::chrono::duration(2s), h);
     fmt::print("push task h into loop queue\n");
 
+    auto c = []() -> task<> { fmt::print("cancelled task should not run\n"); co_return; }();
+    auto id = loop.call_after(std::chrono::duration(1s), c);
+    fmt::print("cancel task c: {}\n", loop.cancel(id));
+
     // add all tasks before this
+    auto wall_start = std::chrono::steady_clock::now();
+    auto cpu_start = std::clock();
     loop.run_until_complete();
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    // idle loop parks until the next timer instead of spinning
+    fmt::print("wall: {}s, cpu: {}s, idle: {}\n", wall.count(), cpu, cpu < wall.count() / 2);
+
+    // other threads hand tasks to a parked loop
+    {
+        Loop loop2;
+        auto keep_alive = []() -> task<> { co_return; }();
+        loop2.call_after(1s, keep_alive);
+
+        constexpr int threads = 4, per_thread = 1000;
+        int count = 0;
+        std::chrono::steady_clock::time_point ran_at;
+        auto increment = [&]() -> task<> { ran_at = std::chrono::steady_clock::now(); count++; co_return; };
+        std::vector<task<>> tasks;
+        for (int i = 0; i < threads * per_thread; i++) tasks.push_back(increment());
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (int i = 0; i < threads; i++)
+            producers.emplace_back([&, i] {
+                std::this_thread::sleep_for(50ms);
+                for (int j = 0; j < per_thread; j++) loop2.call_threadsafe(tasks[static_cast<size_t>(i * per_thread + j)]);
+            });
+        loop2.run_until_complete();
+        for (auto& p : producers) p.join();
+
+        fmt::print("call_threadsafe count == {}: {}\n", threads * per_thread, count == threads * per_thread);
+        fmt::print("woken before the timer: {}\n", ran_at - start < 500ms);
+    }
+
+#if CORO_LOOP_METRICS
+    {
+        auto m = loop.metrics();
+        fmt::print("iterations: {}, handles run: {}, timers fired: {}\n", m.iterations, m.handles_run, m.timers_fired);
+        fmt::print("run time p50: {}ns p99: {}ns max: {}ns\n", m.run_time.percentile(0.5), m.run_time.percentile(0.99), m.run_time.max);
+        fmt::print("timers fired == 2: {}\n", m.timers_fired == 2 && m.timer_lag.count == 2);
+        fmt::print("handles counted: {}\n", m.handles_run == m.run_time.count && m.handles_run == m.handles_per_iteration.sum);
+        fmt::print("timer lag < 10ms: {}\n", m.timer_lag.max < 10000);
+
+        Loop loop3;
+        loop3.track_handles(true);
+        auto once = []() -> task<> { co_return; }();
+        loop3.call(once);
+        loop3.run_until_complete();
+        auto m3 = loop3.metrics();
+        fmt::print("per handle: {}\n", m3.run_time_by_handle.size() == 1 && m3.run_time_by_handle.count(once.promise().get_handle_id()) == 1);
+    }
+#endif
 
     return 0;
 }
\ No newline at end of file
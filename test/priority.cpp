@@ -0,0 +1,189 @@
+// the metrics checks below are part of the test
+#ifndef CORO_LOOP_METRICS
+#define CORO_LOOP_METRICS 1
+#endif
+
+#include "coro/event.h"
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+using clock_type = Loop::clock_type;
+
+task<> record(std::string& order, char id)
+{
+    order += id;
+    co_return;
+}
+
+task<> nap(Loop& loop, std::string& order, char id)
+{
+    co_await loop.sleep_for(1ms);
+    order += id;
+}
+
+// the sleep happens in a child, which inherits the class and deadline of `nap_in_child`
+task<> nap_in_child(Loop& loop, std::string& order, char id)
+{
+    co_await nap(loop, order, id);
+}
+
+task<> wait_for(event& e, std::string& order, char id)
+{
+    co_await e;
+    order += id;
+}
+
+// keeps the loop thread busy, so timers due meanwhile fire in one batch
+task<> stall(std::chrono::milliseconds duration)
+{
+    auto until = clock_type::now() + duration;
+    while (clock_type::now() < until) { }
+    co_return;
+}
+
+// queues `others` before waking up the waiter of `e`
+task<> set_after(Loop& loop, event& e, std::vector<task<>>& others)
+{
+    for (auto& t : others) loop.call(t);
+    e.set(loop);
+    co_return;
+}
+
+// a bit of background work
+task<> busy(int& sink)
+{
+    for (int i = 0; i < 2000; i++) sink += i % 7;
+    co_return;
+}
+
+int main()
+{
+    // weighted round-robin across the classes, FIFO within a class
+    {
+        Loop loop;
+        loop.set_priority_weights(2, 1, 1);
+        std::string order;
+        std::vector<task<>> tasks;
+        for (char id : std::string("abcd")) tasks.push_back(record(order, id));  // low
+        for (char id : std::string("EFGH")) tasks.push_back(record(order, id));  // normal
+        for (char id : std::string("1234")) tasks.push_back(record(order, id));  // high
+        for (size_t i = 0; i < 4; i++) loop.call(tasks[i], priority::low);
+        for (size_t i = 4; i < 8; i++) loop.call(tasks[i]);
+        for (size_t i = 8; i < 12; i++) loop.call(tasks[i], priority::high);
+        loop.run_until_complete();
+        RequireTrue(order == "12Ea34FbGcHd");
+    }
+
+    // deadline tagged handles run first, earliest deadline first, then the classes
+    {
+        Loop loop;
+        std::string order;
+        auto now = clock_type::now();
+        auto a = record(order, 'a'), b = record(order, 'b'), c = record(order, 'c'), d = record(order, 'd'), h = record(order, 'h');
+        loop.call(a);
+        loop.call(h, priority::high);
+        loop.call_with_deadline(b, now + 30ms);
+        loop.call_with_deadline(c, now + 10ms);
+        loop.call_with_deadline(d, now + 30ms);
+        loop.run_until_complete();
+        RequireTrue(order == "cbdha");
+    }
+
+    // the class sticks to a task that suspends, a timer wakes it up ahead of normal work due at the same time
+    {
+        Loop loop;
+        std::string order;
+        auto sleeper = nap_in_child(loop, order, 's');
+        auto busy = stall(5ms);
+        std::vector<task<>> others;
+        for (int i = 0; i < 4; i++) others.push_back(record(order, 'n'));
+        for (auto& t : others) loop.call_after(1ms, t);  // due before the sleeper, which only starts in `run`
+        loop.call(sleeper, priority::high);
+        loop.call(busy);
+        loop.run_until_complete();
+        RequireTrue(order == "snnnn" && sleeper.is_done());
+    }
+
+    // so does the deadline, ahead of every class
+    {
+        Loop loop;
+        std::string order;
+        auto sleeper = nap_in_child(loop, order, 'd');
+        auto busy = stall(5ms);
+        std::vector<task<>> others;
+        for (int i = 0; i < 4; i++) others.push_back(record(order, 'h'));
+        for (auto& t : others)
+        {
+            t.promise().set_priority(priority::high);
+            loop.call_after(1ms, t);
+        }
+        loop.call_with_deadline(sleeper, clock_type::now() + 1s);
+        loop.call(busy);
+        loop.run_until_complete();
+        RequireTrue(order == "dhhhh" && sleeper.is_done());
+    }
+
+    // an event handed to the loop resumes its waiter in the waiter's class
+    {
+        Loop loop;
+        std::string order;
+        event e;
+        auto waiter = wait_for(e, order, 'w');
+        std::vector<task<>> others;
+        for (int i = 0; i < 4; i++) others.push_back(record(order, 'n'));
+        auto setter = set_after(loop, e, others);
+        loop.call(waiter, priority::high);
+        loop.call(setter);
+        loop.run_until_complete();
+        RequireTrue(order == "wnnnn" && waiter.is_done());
+    }
+
+    // weights must be positive
+    {
+        Loop loop;
+        bool thrown = false;
+        try
+        {
+            loop.set_priority_weights(1, 0, 1);
+        }
+        catch (std::invalid_argument const&)
+        {
+            thrown = true;
+        }
+        RequireTrue(thrown);
+    }
+
+#if CORO_LOOP_METRICS
+    // under a burst of background work, latency-sensitive tasks queued after it wait far less than the burst
+    {
+        Loop loop;
+        int sink = 0;
+        std::string order;
+        std::vector<task<>> background, urgent;
+        for (int i = 0; i < 2000; i++) background.push_back(busy(sink));
+        for (int i = 0; i < 8; i++) urgent.push_back(record(order, 'u'));
+        for (auto& t : background) loop.call(t, priority::low);
+        for (auto& t : urgent) loop.call(t);
+        auto late = record(order, 'l');
+        loop.call_with_deadline(late, clock_type::now() - 1ms);
+        loop.run_until_complete();
+
+        auto m = loop.metrics();
+        auto const& low = m.queue_delay[static_cast<size_t>(priority::low)];
+        auto const& normal = m.queue_delay[static_cast<size_t>(priority::normal)];
+        RequireTrue(low.count == 2000 && normal.count == 8 && m.deadline_queue_delay.count == 1);
+        RequireTrue(normal.max < low.max && m.deadline_misses == 1);
+        RequireTrue(m.handles_run == 2009 && m.handles_run == m.run_time.count);
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "coro/profiler.h"
+#include "coro/task.h"
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+
+async_profiler* profiler = nullptr;
+
+task<> leaf()
+{
+    profiler->sample();
+    co_return;
+}
+
+task<> middle()
+{
+    co_await leaf();
+    profiler->sample();
+}
+
+task<> root()
+{
+    co_await middle();
+}
+
+double spin(int n)
+{
+    volatile double x = 0;
+    for (int i = 0; i < n; i++) x = x + i * 0.5;
+    return x;
+}
+
+task<double> busy_leaf()
+{
+    co_return spin(20000000);
+}
+
+task<double> busy_root()
+{
+    auto start = std::chrono::steady_clock::now();
+    double sum = 0;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200))
+        sum += co_await busy_leaf();
+    co_return sum;
+}
+
+int main()
+{
+    {
+        async_profiler p;
+        profiler = &p;
+        auto t = root();
+        t.resume();
+        p.sample();  // outside any task
+
+        for (auto const& [stack, count] : p.stacks()) fmt::print("{} {}\n", stack, count);
+        auto const& stacks = p.stacks();
+        RequireTrue(stacks.size() == 3);
+        RequireTrue(stacks.count("[idle]") == 1);
+        size_t deepest = 0;
+        for (auto const& [stack, count] : stacks)
+            deepest = std::max(deepest, static_cast<size_t>(std::count(stack.begin(), stack.end(), ';')));
+        RequireTrue(deepest == 2);  // root;middle;leaf
+    }
+
+    {
+        async_profiler p(std::chrono::microseconds(500));
+        p.start();
+        auto t = busy_root();
+        t.resume();
+        p.stop();
+
+        size_t in_leaf = 0;
+        for (auto const& [stack, count] : p.stacks())
+            if (stack.find("busy_root") != std::string::npos && stack.find("busy_leaf") != std::string::npos) in_leaf += count;
+        fmt::print("{}", p.folded());
+        RequireTrue(in_leaf > 0);
+        RequireTrue(p.dropped() == 0);
+    }
+
+    return 0;
+}
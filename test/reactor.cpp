@@ -0,0 +1,79 @@
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <string>
+#include <ctime>
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+task<std::string> reader(Loop& loop, int fd)
+{
+    std::string received;
+    char buffer[64];
+    while (true)
+    {
+        auto n = ::read(fd, buffer, sizeof(buffer));
+        if (n > 0) received.append(buffer, static_cast<size_t>(n));
+        else if (n == 0) break;  // writer closed
+        else if (errno == EAGAIN) co_await loop.readable(fd);
+        else break;
+    }
+    co_return received;
+}
+
+task<> writer(int fd, char const* message)
+{
+    [[maybe_unused]] auto n = ::write(fd, message, std::char_traits<char>::length(message));
+    co_return;
+}
+
+task<> closer(int fd)
+{
+    ::close(fd);
+    co_return;
+}
+
+int main()
+{
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK) != 0) return 1;
+
+    Loop loop;
+    auto r = reader(loop, fds[0]);
+    auto w1 = writer(fds[1], "hello ");
+    auto w2 = writer(fds[1], "world");
+    auto c = closer(fds[1]);
+    loop.call(r);
+    loop.call_after(100ms, w1);
+    loop.call_after(200ms, w2);
+    loop.call_after(300ms, c);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    auto cpu_start = std::clock();
+    loop.run_until_complete();
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+    double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    fmt::print("received == \"hello world\": {}\n", r.promise().result() == "hello world");
+    fmt::print("waited for timers: {}\n", wall >= 300ms);
+    fmt::print("wall: {}s, cpu: {}s, idle: {}\n", wall.count(), cpu, cpu < wall.count() / 2);
+
+    loop.forget(fds[0]);
+    ::close(fds[0]);
+
+    // a waiter keeps the loop running until the fd is ready
+    if (::pipe2(fds, O_NONBLOCK) != 0) return 1;
+    auto wait_writable = [](Loop& l, int fd) -> task<> { co_await l.writable(fd); };
+    auto t = wait_writable(loop, fds[1]);
+    loop.call(t);
+    loop.run_until_complete();
+    fmt::print("writable: {}\n", t.is_done());
+    loop.forget(fds[1]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "coro/sharded.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+task<size_t> where(sharded_runtime& rt)
+{
+    co_return rt.current_shard();
+}
+
+task<int> fail()
+{
+    throw std::runtime_error("remote");
+    co_return 0;
+}
+
+task<size_t> nap_on(sharded_runtime& rt)
+{
+    co_await rt.loop(rt.current_shard()).sleep_for(1ms);
+    co_return rt.current_shard();
+}
+
+// from shard 0, visits every shard and checks it is back on shard 0 after each hop
+task<bool> round_trip(sharded_runtime& rt)
+{
+    bool home = rt.current_shard() == 0;
+    for (size_t i = 0; i < rt.size(); i++)
+    {
+        auto remote = co_await rt.submit_to(i, where(rt));
+        home = home && remote == i && rt.current_shard() == 0;
+    }
+    auto slept = co_await rt.submit_to(rt.size() - 1, nap_on(rt));
+    co_return home && slept == rt.size() - 1 && rt.current_shard() == 0;
+}
+
+task<bool> remote_failure(sharded_runtime& rt)
+{
+    try
+    {
+        co_await rt.submit_to(1, fail());
+    }
+    catch (std::runtime_error const&)
+    {
+        co_return rt.current_shard() == 0;
+    }
+    co_return false;
+}
+
+// every shard sends `rounds` messages to its neighbour, one at a time
+task<> ping(sharded_runtime& rt, int rounds, std::atomic<int>& received, std::atomic<int>& finished)
+{
+    auto self = rt.current_shard();
+    auto next = (self + 1) % rt.size();
+    auto pong = [&received](sharded_runtime& r) -> task<size_t> { received++; co_return r.current_shard(); };
+    for (int i = 0; i < rounds; i++)
+    {
+        if (co_await rt.submit_to(next, pong(rt)) != next) co_return;
+    }
+    finished++;
+}
+
+task<> start_pings(sharded_runtime& rt, int rounds, std::atomic<int>& received, std::atomic<int>& finished)
+{
+    for (size_t i = 0; i < rt.size(); i++) rt.spawn_on(i, ping(rt, rounds, received, finished));
+    co_return;
+}
+
+int main()
+{
+    // submitting from outside the runtime resumes on the target shard
+    {
+        sharded_runtime rt{ { .shards = 3 } };
+        RequireTrue(rt.size() == 3 && rt.current_shard() == sharded_runtime::npos);
+        RequireTrue(sync_wait(rt.submit_to(2, where(rt))) == 2);
+    }
+
+    // hops between shards come back to the awaiting shard, exceptions travel with them
+    {
+        sharded_runtime rt{ { .shards = 4, .pin = false } };
+        RequireTrue(sync_wait(rt.submit_to(0, round_trip(rt))));
+        RequireTrue(sync_wait(rt.submit_to(0, remote_failure(rt))));
+    }
+
+    // many messages in flight through small rings, overflow goes through `call_threadsafe`
+    {
+        sharded_runtime rt{ { .shards = 4, .ring_capacity = 2 } };
+        std::atomic<int> received{ 0 }, finished{ 0 };
+        sync_wait(rt.submit_to(0, start_pings(rt, 1000, received, finished)));
+        while (finished.load() != 4) std::this_thread::sleep_for(1ms);
+        RequireTrue(received.load() == 4000);
+    }
+
+    // the shards are parked while idle and stop with work still suspended
+    {
+        sharded_runtime rt{ 2 };
+        auto forever = [](sharded_runtime& r, bool& started) -> task<> { started = true; co_await r.loop(r.current_shard()).sleep_for(1h); };
+        bool started = false;
+        auto t = forever(rt, started);
+        rt.post(1, t.promise());
+        std::this_thread::sleep_for(5ms);
+        rt.stop();
+        RequireTrue(started && !t.is_done());
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <stdexcept>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+struct tracked
+{
+    explicit tracked(int& alive) : m_alive(alive) { m_alive++; }
+    ~tracked() { m_alive--; }
+    int& m_alive;
+};
+
+task<> count_up(int& counter, int& alive)
+{
+    tracked t{ alive };
+    counter++;
+    co_return;
+}
+
+task<int> nap(Loop& loop, int& counter, int& alive)
+{
+    tracked t{ alive };
+    co_await loop.sleep_for(1ms);
+    counter++;
+    co_return counter;
+}
+
+task<> failing(int& alive)
+{
+    tracked t{ alive };
+    throw std::runtime_error("dropped");
+    co_return;
+}
+
+int main()
+{
+    // frames are gone as soon as the tasks finish, nothing is kept by the caller
+    {
+        Loop loop;
+        int counter = 0, alive = 0;
+        for (int i = 0; i < 1000; i++) loop.spawn(count_up(counter, alive));
+        loop.spawn(nap(loop, counter, alive));
+        loop.spawn(failing(alive));
+        loop.run_until_complete();
+        RequireTrue(counter == 1001 && alive == 0);
+    }
+
+    // a batch of tasks in one go
+    {
+        Loop loop;
+        int counter = 0, alive = 0;
+        std::vector<task<int>> batch;
+        for (int i = 0; i < 10000; i++) batch.push_back(nap(loop, counter, alive));
+        loop.spawn_range(batch);
+        RequireTrue(batch.front().handle() == nullptr);  // owned by the loop now
+        loop.run_until_complete();
+        RequireTrue(counter == 10000 && alive == 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "coro/async_mutex.h"
+#include "coro/async_semaphore.h"
+#include "coro/async_rwlock.h"
+#include "coro/event.h"
+#include "coro/thread_pool.h"
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+
+task<> locked_append(async_mutex& mutex, event const& e, std::vector<int>& order, int id)
+{
+    auto lock = co_await mutex.scoped_lock_async();
+    co_await e;
+    order.push_back(id);
+}
+
+task<> increment(thread_pool& pool, async_mutex& mutex, int& counter, std::atomic<int>& done)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        co_await pool.schedule();
+        auto lock = co_await mutex.scoped_lock_async();
+        counter++;  // not atomic, the mutex serializes it
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+task<> limited(thread_pool& pool, async_semaphore& semaphore, std::atomic<int>& inside, std::atomic<int>& peak, std::atomic<int>& done)
+{
+    for (int i = 0; i < 200; i++)
+    {
+        co_await pool.schedule();
+        auto permit = co_await semaphore.scoped_acquire_async();
+        auto now = inside.fetch_add(1) + 1;
+        for (auto p = peak.load(); now > p && !peak.compare_exchange_weak(p, now); ) { }
+        co_await pool.schedule();
+        inside.fetch_sub(1);
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+task<> reader(async_rwlock& lock, event const& e, int& readers_inside)
+{
+    auto l = co_await lock.scoped_lock_shared_async();
+    readers_inside++;
+    co_await e;
+    readers_inside--;
+}
+
+task<> writer(async_rwlock& lock, event const& e, std::vector<int>& order, int id)
+{
+    auto l = co_await lock.scoped_lock_async();
+    order.push_back(id);
+    co_await e;
+}
+
+task<> rw_worker(thread_pool& pool, async_rwlock& lock, int& value, std::atomic<bool>& torn, std::atomic<int>& done, bool writes)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        co_await pool.schedule();
+        if (writes)
+        {
+            auto l = co_await lock.scoped_lock_async();
+            value++;
+            value++;
+        }
+        else
+        {
+            auto l = co_await lock.scoped_lock_shared_async();
+            if (value % 2 != 0) torn.store(true);
+        }
+    }
+    done.fetch_add(1);
+    done.notify_one();
+}
+
+void wait_for(std::atomic<int>& done, int count)
+{
+    for (int d = done.load(); d < count; d = done.load()) done.wait(d);
+}
+
+int main()
+{
+    // FIFO handoff
+    {
+        async_mutex mutex;
+        event e1, e2, e3;
+        std::vector<int> order;
+        auto t1 = locked_append(mutex, e1, order, 1);
+        auto t2 = locked_append(mutex, e2, order, 2);
+        auto t3 = locked_append(mutex, e3, order, 3);
+        t1.resume();
+        t2.resume();
+        t3.resume();
+        RequireTrue(!mutex.try_lock());
+        e3.set();
+        e2.set();
+        e1.set();  // t1 unlocks, t2 gets the lock and completes since e2 is set, then t3
+        RequireTrue((order == std::vector<int>{ 1, 2, 3 }));
+        RequireTrue(mutex.try_lock());
+        mutex.unlock();
+    }
+
+    {
+        async_mutex mutex;
+        int counter = 0;
+        std::atomic<int> done{ 0 };
+        std::vector<task<>> tasks;
+        {
+            thread_pool pool{ 4 };
+            for (int i = 0; i < 8; i++) tasks.push_back(increment(pool, mutex, counter, done));
+            for (auto& t : tasks) pool.call(t);
+            wait_for(done, 8);
+        }
+        RequireTrue(counter == 8000);
+    }
+
+    // semaphore bounds concurrency
+    {
+        async_semaphore semaphore{ 3 };
+        std::atomic<int> inside{ 0 }, peak{ 0 }, done{ 0 };
+        std::vector<task<>> tasks;
+        {
+            thread_pool pool{ 4 };
+            for (int i = 0; i < 8; i++) tasks.push_back(limited(pool, semaphore, inside, peak, done));
+            for (auto& t : tasks) pool.call(t);
+            wait_for(done, 8);
+        }
+        RequireTrue(peak.load() <= 3 && peak.load() >= 1);
+        RequireTrue(semaphore.available() == 3);
+    }
+
+    // readers share, a waiting writer keeps new readers out
+    {
+        async_rwlock lock;
+        event r, w, late;
+        int readers_inside = 0;
+        std::vector<int> order;
+        auto r1 = reader(lock, r, readers_inside);
+        auto r2 = reader(lock, r, readers_inside);
+        r1.resume();
+        r2.resume();
+        RequireTrue(readers_inside == 2);
+
+        auto w1 = writer(lock, w, order, 1);
+        w1.resume();
+        auto r3 = reader(lock, late, readers_inside);
+        r3.resume();
+        RequireTrue(order.empty() && readers_inside == 2);  // r3 queued behind the writer
+
+        r.set();  // the last reader hands over to the writer
+        RequireTrue((order == std::vector<int>{ 1 }) && readers_inside == 0);
+        w.set();  // the writer leaves, r3 gets in
+        RequireTrue(w1.is_done() && readers_inside == 1);
+        late.set();
+        RequireTrue(r3.is_done() && lock.try_lock());
+        lock.unlock();
+    }
+
+    {
+        async_rwlock lock;
+        int value = 0;
+        std::atomic<bool> torn{ false };
+        std::atomic<int> done{ 0 };
+        std::vector<task<>> tasks;
+        {
+            thread_pool pool{ 4 };
+            for (int i = 0; i < 8; i++) tasks.push_back(rw_worker(pool, lock, value, torn, done, i % 2 == 0));
+            for (auto& t : tasks) pool.call(t);
+            wait_for(done, 8);
+        }
+        RequireTrue(value == 4 * 500 * 2 && !torn.load());
+    }
+
+    return 0;
+}
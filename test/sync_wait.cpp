@@ -0,0 +1,79 @@
+#include "coro/sync_wait.h"
+#include "coro/event.h"
+#include "coro/thread_pool.h"
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+static_assert(concepts::Awaitable<task<int>> && concepts::Awaitable<event&>);
+
+task<uint64_t> fib(int n)
+{
+    if (n < 2) co_return static_cast<uint64_t>(n);
+    co_return (co_await fib(n - 1)) + (co_await fib(n - 2));
+}
+
+task<std::unique_ptr<int>> on_pool(thread_pool& pool, std::thread::id& ran_on)
+{
+    co_await pool.schedule();
+    ran_on = std::this_thread::get_id();
+    co_return std::make_unique<int>(static_cast<int>(co_await fib(20)));
+}
+
+task<> failing(thread_pool& pool)
+{
+    co_await pool.schedule();
+    throw std::runtime_error("broken");
+}
+
+int main()
+{
+    // completes synchronously, the flag is set before the caller would sleep
+    RequireTrue(sync_wait(fib(20)) == 6765);
+
+    // finishes on a pool thread while the caller blocks
+    {
+        thread_pool pool{ 2 };
+        std::thread::id ran_on;
+        auto p = sync_wait(on_pool(pool, ran_on));
+        RequireTrue(p != nullptr && *p == 6765 && ran_on != std::this_thread::get_id());
+
+        bool caught = false;
+        try
+        {
+            sync_wait(failing(pool));
+        }
+        catch (std::runtime_error const&)
+        {
+            caught = true;
+        }
+        RequireTrue(caught);
+    }
+
+    // any awaitable, here an event set by another thread
+    {
+        event e;
+        std::thread setter([&] {
+            std::this_thread::sleep_for(10ms);
+            e.set();
+        });
+        sync_wait(e);
+        RequireTrue(e.is_set());
+        setter.join();
+    }
+
+    // lvalue tasks yield a reference to their result
+    {
+        auto t = fib(10);
+        uint64_t const& r = sync_wait(t);
+        RequireTrue(r == 55 && &r == &t.promise().result());
+    }
+
+    return 0;
+}
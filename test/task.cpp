@@ -1,6 +1,8 @@
 #include "coro/task.h"
 #include <string>
 #include <stdexcept>
+#include <memory_resource>
+#include <memory>
 
 using namespace coro;
 
@@ -39,6 +41,55 @@ task<> task_inside_task()
     co_return;
 }
 
+// counts frames routed through `set_frame_resource`
+struct counting_resource : std::pmr::memory_resource
+{
+    size_t allocated = 0;
+    size_t deallocated = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override { allocated++; return std::pmr::new_delete_resource()->allocate(bytes, alignment); }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override { deallocated++; std::pmr::new_delete_resource()->deallocate(p, bytes, alignment); }
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+};
+
+// a request's task tree allocated from one arena
+task<int> arena_factorial(std::allocator_arg_t, std::pmr::memory_resource* arena, int n)
+{
+    if (n <= 1) co_return 1;
+    co_return (co_await arena_factorial(std::allocator_arg, arena, n - 1)) * n;
+}
+
+struct request_handler
+{
+    int base = 10;
+
+    task<int> handle(std::allocator_arg_t, std::pmr::polymorphic_allocator<> alloc, int n)
+    {
+        co_return base + co_await arena_factorial(std::allocator_arg, alloc.resource(), n);
+    }
+};
+
+template<typename T>
+struct counting_allocator
+{
+    using value_type = T;
+
+    size_t* allocated;
+    size_t* deallocated;
+
+    counting_allocator(size_t* a, size_t* d) noexcept : allocated(a), deallocated(d) { }
+    template<typename U>
+    counting_allocator(counting_allocator<U> const& other) noexcept : allocated(other.allocated), deallocated(other.deallocated) { }
+
+    T* allocate(size_t n) { ++*allocated; return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) noexcept { ++*deallocated; std::allocator<T>().deallocate(p, n); }
+};
+
+task<int> allocator_task(std::allocator_arg_t, counting_allocator<int>, int n)
+{
+    co_return n;
+}
+
 int main()
 {
     auto t = task_void();
@@ -71,7 +122,42 @@ int main()
     auto t5 = task_inside_task();
     t5.resume();
     fmt::print("{}\n", t5.is_done());
-    
+
+    {
+        counting_resource resource;
+        set_frame_resource(&resource);
+        {
+            auto t6 = factorial(5);  // 5 frames
+            t6.resume();
+            set_frame_resource(nullptr);  // frames remember their resource
+            fmt::print("{}\n", t6.promise().result());
+        }
+        fmt::print("frames allocated == 5: {}, deallocated == 5: {}\n", resource.allocated == 5, resource.deallocated == 5);
+    }
+
+    {
+        counting_resource upstream;
+        {
+            std::pmr::monotonic_buffer_resource arena(4096, &upstream);
+            auto t7 = arena_factorial(std::allocator_arg, &arena, 5);
+            t7.resume();
+            fmt::print("{}\n", t7.promise().result());
+
+            request_handler handler;
+            auto t8 = handler.handle(std::allocator_arg, &arena, 3);
+            t8.resume();
+            fmt::print("{}\n", t8.promise().result());
+        }
+        fmt::print("arena chunks allocated == 1: {}, released == 1: {}\n", upstream.allocated == 1, upstream.deallocated == 1);
+
+        size_t allocated = 0, deallocated = 0;
+        {
+            auto t9 = allocator_task(std::allocator_arg, counting_allocator<int>(&allocated, &deallocated), 42);
+            t9.resume();
+            fmt::print("{}\n", t9.promise().result());
+        }
+        fmt::print("allocator used: {}, released: {}\n", allocated == 1, deallocated == 1);
+    }
 
     return 0;
 }
\ No newline at end of file
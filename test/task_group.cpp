@@ -0,0 +1,131 @@
+#include "coro/task_group.h"
+#include "coro/loop.h"
+#include "coro/thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+task<int> child(Loop& loop, std::chrono::milliseconds delay, int id, std::vector<int>& done)
+{
+    co_await loop.sleep_for(delay);
+    done.push_back(id);
+    co_return id;
+}
+
+task<> failing(Loop& loop)
+{
+    co_await loop.sleep_for(5ms);
+    throw std::runtime_error("broken");
+}
+
+// spawns a dynamic number of children, a child spawns a sibling
+task<> fan_out(Loop& loop, int count, std::vector<int>& done)
+{
+    task_group group{ loop };
+    for (int i = 0; i < count; i++) group.spawn(child(loop, std::chrono::milliseconds(count - i), i, done));
+    auto spawner = [&]() -> task<> { group.spawn(child(loop, 1ms, 100, done)); co_return; };
+    group.spawn(spawner());
+    co_await group.join();
+}
+
+task<bool> fail_fast(Loop& loop, std::vector<int>& done)
+{
+    task_group group{ loop };
+    group.spawn(child(loop, 2s, 1, done));
+    group.spawn(failing(loop));
+    try
+    {
+        co_await group.join();
+    }
+    catch (std::runtime_error const&)
+    {
+        co_return true;
+    }
+    co_return false;
+}
+
+task<> pool_fan_out(thread_pool& pool, std::atomic<int>& counter, std::atomic<bool>& joined)
+{
+    co_await pool.schedule();
+    {
+        task_group group{ pool };
+        auto increment = [&]() -> task<> { counter.fetch_add(1); co_return; };
+        for (int i = 0; i < 1000; i++) group.spawn(increment());
+        co_await group.join();
+    }
+    joined.store(true);
+    joined.notify_one();
+}
+
+int main()
+{
+    // children owned by the group, join waits for all of them
+    {
+        Loop loop;
+        std::vector<int> done;
+        auto t = fan_out(loop, 10, done);
+        loop.call(t);
+        loop.run_until_complete();
+        RequireTrue(t.is_done() && done.size() == 11 && std::ranges::count(done, 100) == 1);
+    }
+
+    // the first exception cancels the siblings and reaches join
+    {
+        Loop loop;
+        std::vector<int> done;
+        auto t = fail_fast(loop, done);
+        auto start = clock_type::now();
+        loop.call(t);
+        loop.run_until_complete();
+        RequireTrue(t.promise().result() && done.empty() && clock_type::now() - start < 1s);
+    }
+
+    // cancelling the parent cancels the group's children
+    {
+        Loop loop;
+        cancellation_source source;
+        std::vector<int> done;
+        bool cancelled = false;
+        auto body = [&]() -> task<> {
+            task_group group{ loop, co_await current_cancellation_token() };
+            group.spawn(child(loop, 2s, 1, done));
+            try
+            {
+                co_await group.join();
+            }
+            catch (operation_cancelled const&)
+            {
+                cancelled = true;
+            }
+        };
+        auto t = body();
+        t.promise().set_cancellation_token(source.token());
+        auto stop = [&]() -> task<> { source.request_cancellation(); co_return; };
+        auto s = stop();
+        loop.call(t);
+        loop.call_after(5ms, s);
+        loop.run_until_complete();
+        RequireTrue(cancelled && done.empty());
+    }
+
+    // children completing on pool threads
+    {
+        std::atomic<int> counter{ 0 };
+        std::atomic<bool> joined{ false };
+        task<> t;
+        thread_pool pool{ 4 };  // joined before the task is destroyed
+        t = pool_fan_out(pool, counter, joined);
+        t.resume();
+        joined.wait(false);
+        RequireTrue(counter.load() == 1000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "coro/thread_pool.h"
+#include <vector>
+#include <set>
+#include <thread>
+#include <fmt/core.h>
+
+using namespace coro;
+
+std::atomic<int> finished{ 0 };
+
+task<uint64_t> fib(int n)
+{
+    if (n < 2) co_return static_cast<uint64_t>(n);
+    co_return (co_await fib(n - 1)) + (co_await fib(n - 2));
+}
+
+task<> worker(thread_pool& pool, int n, std::thread::id& ran_on, uint64_t& result)
+{
+    co_await pool.schedule();
+    ran_on = std::this_thread::get_id();
+    result = co_await fib(n);
+    finished.fetch_add(1);
+    finished.notify_one();
+}
+
+int main()
+{
+    constexpr int count = 64;
+    std::vector<task<>> tasks;
+    task<> t;
+    std::atomic<bool> flag{ false };
+    thread_pool pool{ 4 };  // joined before the tasks are destroyed
+    fmt::print("thread count == 4: {}\n", pool.thread_count() == 4);
+
+    std::vector<std::thread::id> ids(count);
+    std::vector<uint64_t> results(count);
+    for (int i = 0; i < count; i++)
+    {
+        tasks.push_back(worker(pool, 20, ids[i], results[i]));
+        tasks.back().resume();  // hops onto the pool at `schedule()`
+    }
+
+    for (int done = finished.load(); done < count; done = finished.load())
+        finished.wait(done);
+
+    bool all_correct = true;
+    for (auto r : results) all_correct = all_correct && r == 6765;
+    fmt::print("all results == 6765: {}\n", all_correct);
+
+    std::set<std::thread::id> threads(ids.begin(), ids.end());
+    fmt::print("main thread unused: {}\n", !threads.contains(std::this_thread::get_id()));
+    fmt::print("ran on {} pool threads\n", threads.size());
+
+    // `call` starts a task on the pool directly
+    t = [](std::atomic<bool>& f) -> task<> { f.store(true); f.notify_one(); co_return; }(flag);
+    pool.call(t);
+    flag.wait(false);
+    fmt::print("call: {}\n", flag.load());
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "coro/timeout.h"
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <string>
+#include <vector>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+task<> sleeper(Loop& loop, std::chrono::milliseconds delay, std::vector<int>& order, int id)
+{
+    co_await loop.sleep_for(delay);
+    order.push_back(id);
+}
+
+task<int> slow_answer(Loop& loop, std::chrono::milliseconds delay, bool& cancelled)
+{
+    try
+    {
+        co_await loop.sleep_for(delay);
+    }
+    catch (operation_cancelled const&)
+    {
+        cancelled = true;
+        throw;
+    }
+    co_return 42;
+}
+
+task<int> immediate() { co_return 7; }
+
+task<std::string> bounded(Loop& loop, std::chrono::milliseconds work, std::chrono::milliseconds limit, bool& cancelled)
+{
+    try
+    {
+        int answer = co_await with_timeout(loop, slow_answer(loop, work, cancelled), limit);
+        co_return std::to_string(answer);
+    }
+    catch (operation_timed_out const&)
+    {
+        co_return "timed out";
+    }
+}
+
+// keeps the loop thread busy, so timers due meanwhile fire in one batch
+task<> stall(std::chrono::milliseconds duration)
+{
+    auto until = clock_type::now() + duration;
+    while (clock_type::now() < until) { }
+    co_return;
+}
+
+task<> cancel_after(cancellation_source& source)
+{
+    source.request_cancellation();
+    co_return;
+}
+
+// records whether `cancelled` was already set when `request_cancellation` returned
+task<> cancel_and_look(cancellation_source& source, bool const& cancelled, bool& inline_resume)
+{
+    source.request_cancellation();
+    inline_resume = cancelled;
+    co_return;
+}
+
+int main()
+{
+    // sleepers resume in deadline order, not before their deadline
+    {
+        Loop loop;
+        std::vector<int> order;
+        auto a = sleeper(loop, 30ms, order, 1);
+        auto b = sleeper(loop, 10ms, order, 2);
+        auto start = clock_type::now();
+        loop.call(a);
+        loop.call(b);
+        loop.run_until_complete();
+        RequireTrue((order == std::vector<int>{ 2, 1 }) && clock_type::now() - start >= 30ms);
+    }
+
+    // a cancelled sleep throws in the next iteration, not inside the canceller
+    {
+        Loop loop;
+        cancellation_source source;
+        bool cancelled = false, inline_resume = true;
+        auto s = slow_answer(loop, 1s, cancelled);
+        s.promise().set_cancellation_token(source.token());
+        auto c = cancel_and_look(source, cancelled, inline_resume);
+        auto start = clock_type::now();
+        loop.call(s);
+        loop.call_after(5ms, c);
+        loop.run_until_complete();
+        RequireTrue(cancelled && !inline_resume && s.is_done() && clock_type::now() - start < 500ms);
+    }
+
+    // the task wins, its timer is dropped and the loop does not wait for it
+    {
+        Loop loop;
+        bool cancelled = false;
+        auto t = bounded(loop, 5ms, 2s, cancelled);
+        auto start = clock_type::now();
+        loop.call(t);
+        loop.run_until_complete();
+        RequireTrue(t.promise().result() == "42" && !cancelled && clock_type::now() - start < 1s);
+    }
+
+    // the timeout wins, the late task is cancelled
+    {
+        Loop loop;
+        bool cancelled = false;
+        auto t = bounded(loop, 2s, 10ms, cancelled);
+        auto start = clock_type::now();
+        loop.call(t);
+        loop.run_until_complete();
+        RequireTrue(t.promise().result() == "timed out" && cancelled && clock_type::now() - start < 1s);
+    }
+
+    // a lagging loop fires the task's wake up and the deadline in the same batch, the task still wins
+    {
+        Loop loop;
+        bool cancelled = false;
+        auto t = bounded(loop, 1ms, 5ms, cancelled);
+        auto busy = stall(30ms);
+        loop.call(t);
+        loop.call(busy);
+        loop.run_until_complete();
+        RequireTrue(t.promise().result() == "42" && !cancelled);
+    }
+
+    // completing synchronously never suspends the awaiting task
+    {
+        Loop loop;
+        int value = 0;
+        auto body = [&]() -> task<> { value = co_await with_timeout(loop, immediate(), 1ms); };
+        auto t = body();
+        t.resume();
+        RequireTrue(t.is_done() && value == 7);
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "coro/timer.h"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <fmt/core.h>
+
+using namespace coro;
+using namespace std::chrono_literals;
+
+template<typename Timer>
+void check(char const* name)
+{
+    Timer timers;
+    std::vector<int> fired;
+
+    timers.add(30us, 3);
+    timers.add(10us, 1);
+    auto id = timers.add(20us, 2);
+    timers.add(5000000us, 5);  // needs cascading
+    timers.add(std::chrono::duration_cast<std::chrono::microseconds>(48h), 6);  // beyond the wheel span
+    fmt::print("{} size == 5: {}\n", name, timers.size() == 5);
+
+    fmt::print("{} cancel: {}\n", name, timers.cancel(id));
+    fmt::print("{} cancel twice: {}\n", name, !timers.cancel(id));
+
+    timers.expire(25us, [&](int v) { fired.push_back(v); });
+    fmt::print("{} expire 25us == [1]: {}\n", name, fired == std::vector{ 1 });
+
+    timers.expire(4999999us, [&](int v) { fired.push_back(v); });
+    fmt::print("{} expire 4999999us == [1, 3]: {}\n", name, fired == std::vector{ 1, 3 });
+    fmt::print("{} next deadline <= 5000000us: {}\n", name, timers.next_deadline() <= 5000000us);
+
+    timers.expire(5000000us, [&](int v) { fired.push_back(v); });
+    fmt::print("{} expire 5000000us == [1, 3, 5]: {}\n", name, fired == std::vector{ 1, 3, 5 });
+
+    timers.expire(std::chrono::duration_cast<std::chrono::microseconds>(48h), [&](int v) { fired.push_back(v); });
+    fmt::print("{} expire 48h == [1, 3, 5, 6]: {}\n", name, fired == std::vector{ 1, 3, 5, 6 });
+    fmt::print("{} empty: {}\n", name, timers.empty() && !timers.next_deadline());
+
+    // random deadlines expire in order and exactly once
+    auto const base = std::chrono::duration_cast<std::chrono::microseconds>(48h);
+    std::mt19937_64 rng{ 42 };
+    std::vector<std::chrono::microseconds> deadlines;
+    for (int i = 0; i < 10000; i++)
+    {
+        auto d = base + std::chrono::microseconds(static_cast<int64_t>(rng() % 100000000));
+        deadlines.push_back(d);
+        timers.add(d, i);
+    }
+    std::chrono::microseconds last{ 0 };
+    bool ordered = true;
+    size_t count = 0;
+    for (auto t = base; !timers.empty(); t += 997us)
+        count += timers.expire(t, [&](int v) {
+            ordered = ordered && deadlines[v] >= last && deadlines[v] <= t;
+            last = deadlines[v];
+        });
+    fmt::print("{} random expiry ordered: {}, count == 10000: {}\n", name, ordered, count == 10000);
+}
+
+int main()
+{
+    check<timing_wheel<int>>("wheel");
+    check<timer_heap<int>>("heap");
+
+    return 0;
+}
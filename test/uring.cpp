@@ -0,0 +1,111 @@
+#include "coro/loop.h"
+#include "coro/task.h"
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <cstring>
+
+using namespace coro;
+
+task<bool> file_io(Loop& loop, char const* path)
+{
+    auto& io = loop.io();
+    int fd = co_await io.openat(AT_FDCWD, path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) co_return false;
+
+    char const message[] = "hello io";
+    auto written = co_await io.write(fd, message, sizeof(message) - 1, 0);
+    auto synced = co_await io.fsync(fd);
+    bool ok = written == 8 && synced == 0;
+
+    char buffer[16]{ };
+    auto n = co_await io.read(fd, buffer, sizeof(buffer), 0);
+    ok = ok && n == 8 && std::string(buffer) == "hello io";
+
+    char a[5]{ }, b[5]{ };
+    iovec iov[2]{ { a, 4 }, { b, 4 } };
+    n = co_await io.readv(fd, iov, 2, 0);
+    ok = ok && n == 8 && std::string(a) == "hell" && std::string(b) == "o io";
+
+    // registered buffer and fixed file
+    char fixed[16]{ };
+    iovec registered{ fixed, sizeof(fixed) };
+    io.register_buffers({ &registered, 1 });
+    io.register_files({ &fd, 1 });
+    n = co_await io.read_fixed(0, fixed, 5, 0, 0).fixed_file();
+    ok = ok && n == 5 && std::string(fixed) == "hello";
+    io.unregister_files();
+    io.unregister_buffers();
+
+    ::close(fd);
+    ::unlink(path);
+    co_return ok;
+}
+
+task<bool> server(Loop& loop, int listener)
+{
+    auto& io = loop.io();
+    int fd = co_await io.accept(listener);
+    if (fd < 0) co_return false;
+    char buffer[16]{ };
+    auto n = co_await io.recv(fd, buffer, sizeof(buffer));
+    auto sent = co_await io.send(fd, "pong", 4);
+    bool ok = n == 4 && std::string(buffer) == "ping" && sent == 4;
+    loop.forget(fd);
+    ::close(fd);
+    co_return ok;
+}
+
+task<bool> client(Loop& loop, sockaddr_in address)
+{
+    auto& io = loop.io();
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (co_await io.connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) co_return false;
+    auto sent = co_await io.send(fd, "ping", 4);
+    char buffer[16]{ };
+    auto n = co_await io.recv(fd, buffer, sizeof(buffer));
+    bool ok = sent == 4 && n == 4 && std::string(buffer) == "pong";
+    loop.forget(fd);
+    ::close(fd);
+    co_return ok;
+}
+
+void check(bool use_io_uring)
+{
+    Loop loop;
+    auto enabled = loop.io().enable_io_uring(use_io_uring);
+    auto name = enabled ? "io_uring" : "epoll";
+
+    auto f = file_io(loop, "/tmp/coro_uring_test");
+    loop.call(f);
+
+    int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_in address{ };
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::listen(listener, 8);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+
+    auto s = server(loop, listener);
+    auto c = client(loop, address);
+    loop.call(s);
+    loop.call(c);
+    loop.run_until_complete();
+
+    fmt::print("{} file io: {}\n", name, f.promise().result());
+    fmt::print("{} server: {}\n", name, s.promise().result());
+    fmt::print("{} client: {}\n", name, c.promise().result());
+
+    loop.forget(listener);
+    ::close(listener);
+}
+
+int main()
+{
+    check(true);
+    check(false);
+
+    return 0;
+}
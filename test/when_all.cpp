@@ -0,0 +1,164 @@
+#include "coro/when_all.h"
+#include "coro/when_any.h"
+#include "coro/event.h"
+#include "coro/thread_pool.h"
+#include <stdexcept>
+#include <string>
+#include <fmt/core.h>
+
+#define RequireTrue(x) fmt::print("Require True: {}\n", x)
+
+using namespace coro;
+
+task<int> value(int v) { co_return v; }
+task<std::string> text() { co_return "text"; }
+task<> nothing() { co_return; }
+task<int> fail() { throw std::runtime_error("failed"); co_return 0; }
+
+task<int> wait_for(event const& e, int v, int& finished)
+{
+    co_await e;
+    finished++;
+    co_return v;
+}
+
+// the task that awaited it may be gone by the time it prints its backtrace
+task<int> wait_and_dump(event const& e, int v, int& finished)
+{
+    co_await e;
+    co_await dump_callstack();
+    finished++;
+    co_return v;
+}
+
+task<uint64_t> fib(int n)
+{
+    if (n < 2) co_return static_cast<uint64_t>(n);
+    co_return (co_await fib(n - 1)) + (co_await fib(n - 2));
+}
+
+task<uint64_t> on_pool(thread_pool& pool, int n)
+{
+    co_await pool.schedule();
+    co_return co_await fib(n);
+}
+
+int main()
+{
+    // synchronous children complete while being started
+    {
+        auto t = []() -> task<> {
+            auto [a, s, v] = co_await when_all(value(1), text(), nothing());
+            RequireTrue(a == 1 && s == "text");
+            (void)v;
+
+            std::vector<task<int>> tasks;
+            for (int i = 0; i < 10; i++) tasks.push_back(value(i));
+            auto results = co_await when_all(std::move(tasks));
+            int sum = 0;
+            for (auto r : results) sum += r;
+            RequireTrue(sum == 45);
+
+            try
+            {
+                co_await when_all(value(1), fail());
+                RequireTrue(false);
+            }
+            catch (std::runtime_error const& e)
+            {
+                RequireTrue(std::string(e.what()) == "failed");
+            }
+        }();
+        t.resume();
+        RequireTrue(t.is_done());
+    }
+
+    // children suspend and complete later, the last one resumes the awaiter
+    {
+        event e1, e2;
+        int finished = 0;
+        std::tuple<int, int> result{ };
+        auto body = [&]() -> task<> { result = co_await when_all(wait_for(e1, 1, finished), wait_for(e2, 2, finished)); };  // outlives the coroutine
+        auto t = body();
+        t.resume();
+        e2.set();
+        RequireTrue(!t.is_done());
+        e1.set();
+        RequireTrue(t.is_done() && result == std::make_tuple(1, 2) && finished == 2);
+    }
+
+    // children finishing on other threads
+    {
+        std::atomic<bool> done{ false };
+        uint64_t sum = 0;
+        task<> t;
+        {
+            thread_pool pool{ 4 };
+            auto body = [&]() -> task<> {
+                std::vector<task<uint64_t>> tasks;
+                for (int i = 0; i < 16; i++) tasks.push_back(on_pool(pool, 20));
+                for (auto r : co_await when_all(std::move(tasks))) sum += r;
+                done.store(true);
+                done.notify_one();
+            };
+            t = body();
+            t.resume();
+            done.wait(false);
+        }
+        RequireTrue(sum == 16 * 6765);
+    }
+
+    // first completion wins, the others are detached
+    {
+        event e1, e2, e3;
+        int finished = 0;
+        size_t index = 99;
+        int result = 0;
+        auto body = [&]() -> task<> {
+            auto r = co_await when_any(wait_for(e1, 1, finished), wait_for(e2, 2, finished), wait_for(e3, 3, finished));
+            index = r.index;
+            result = r.value;
+        };
+        auto t = body();
+        t.resume();
+        e2.set();
+        RequireTrue(t.is_done() && index == 1 && result == 2);
+        e1.set();
+        e3.set();
+        RequireTrue(finished == 3);  // losers ran to completion, the state is freed by the last one
+    }
+
+    // a loser outliving the awaiting task does not link back to its frame
+    {
+        event e1, e2;
+        int finished = 0;
+        auto body = [&]() -> task<> { co_await when_any(wait_for(e1, 1, finished), wait_and_dump(e2, 2, finished)); };
+        {
+            auto t = body();
+            t.resume();
+            e1.set();
+            RequireTrue(t.is_done());
+        }
+        e2.set();
+        RequireTrue(finished == 2);
+    }
+
+    // a synchronous winner cancels the tasks after it
+    {
+        event never;
+        int finished = 0;
+        size_t index = 99;
+        auto body = [&]() -> task<> {
+            std::vector<task<int>> tasks;
+            tasks.push_back(value(7));
+            tasks.push_back(wait_for(never, 0, finished));
+            auto r = co_await when_any(std::move(tasks));
+            index = r.index;
+        };
+        auto t = body();
+        t.resume();
+        RequireTrue(t.is_done() && index == 0 && finished == 0);
+    }
+
+    return 0;
+}